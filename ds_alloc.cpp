@@ -0,0 +1,405 @@
+#include "ds_alloc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#endif
+
+#define REGION_BYTES ((size_t)2 << 20)
+#define REGION_HEADER_BYTES 64
+#define SIZE_GRAIN 16
+#define MAX_NODE_BYTES 4096
+#define NUM_CLASSES (MAX_NODE_BYTES / SIZE_GRAIN)
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+// ʽָ 2MB ҳ MAP_HUGETLB ϵͳĬϴСĬΪ 1GB ʱһռһҳ
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+struct NodeArena;
+
+// ÿ 2MB ͷͷnode_free ַһ arena
+typedef struct Region {
+    struct NodeArena* arena;
+    struct Region* next;
+    void* map_base;
+    size_t map_bytes;
+    int explicit_pages;
+} Region;
+
+// һ (NUMA ڵ, С) Ľڵأͬһʱֻһ̡߳numa_node Ϊ -1 ʾ󶨽ڵ㡣
+// ߳ش free_list / ǰ䣻߳ͷŵĽڵѹ remote_free
+//  free_list ʱ exchange һȡ
+typedef struct NodeArena {
+    size_t slot_bytes;
+    int numa_node;
+    char* bump;
+    char* bump_end;
+    void* free_list;
+    std::atomic<void*> remote_free;
+    std::atomic<int> owned;
+    struct NodeArena* next;
+} NodeArena;
+
+// arenas ĵһά numa_node + 1 0 Ųλǲ󶨽ڵĳء
+// live Ǳ߳ node_alloc ȥ node_free ֻб߳длʱ
+typedef struct ThreadArenas {
+    NodeArena* arenas[NODE_ALLOC_MAX_NUMA_NODES + 1][NUM_CLASSES];
+    int numa_node;
+    int bound;
+    int registered;
+    std::atomic<long long> live;
+    struct ThreadArenas* next;
+    ~ThreadArenas();
+} ThreadArenas;
+
+static std::mutex global_lock;                 //  exited_live
+static NodeArena* all_arenas = NULL;
+static Region* all_regions = NULL;
+static ThreadArenas* all_threads = NULL;
+static long long exited_live = 0;              // ˳߳µ live ֮
+static std::atomic<int> region_count(0);
+static std::atomic<int> explicit_region_count(0);
+static std::atomic<int> alloc_flags(0);
+static std::atomic<const NodeAllocBackend*> current_backend(&node_alloc_malloc_backend);
+static thread_local ThreadArenas thread_arenas;
+
+// ߳˳ʱȨarena ͬдĽڵ߳̽ӹ
+ThreadArenas::~ThreadArenas() {
+    for (int n = 0; n <= NODE_ALLOC_MAX_NUMA_NODES; n++) {
+        for (int c = 0; c < NUM_CLASSES; c++) {
+            if (arenas[n][c]) arenas[n][c]->owned.store(0);
+        }
+    }
+    if (!registered) return;
+    global_lock.lock();
+    exited_live += live.load(std::memory_order_relaxed);
+    for (ThreadArenas** link = &all_threads; *link; link = &(*link)->next) {
+        if (*link == this) {
+            *link = next;
+            break;
+        }
+    }
+    global_lock.unlock();
+}
+
+static void register_thread(void) {
+    global_lock.lock();
+    thread_arenas.next = all_threads;
+    all_threads = &thread_arenas;
+    thread_arenas.registered = 1;
+    global_lock.unlock();
+}
+
+static void count_live(long long delta) {
+    if (!thread_arenas.registered) register_thread();
+    thread_arenas.live.store(thread_arenas.live.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// ߳̾ node_alloc 䡢δ node_free Ľڵֻûвʱȷ
+static long long live_allocations(void) {
+    global_lock.lock();
+    long long total = exited_live;
+    for (ThreadArenas* t = all_threads; t; t = t->next)
+        total += t->live.load(std::memory_order_relaxed);
+    global_lock.unlock();
+    return total;
+}
+
+int node_alloc_current_numa_node(void) {
+    int node = -1;
+#ifdef _WIN32
+    PROCESSOR_NUMBER pn;
+    USHORT win_node = 0;
+    GetCurrentProcessorNumberEx(&pn);
+    if (GetNumaProcessorNodeEx(&pn, &win_node)) node = win_node;
+#elif defined(SYS_getcpu)
+    unsigned int cpu = 0, linux_node = 0;
+    if (syscall(SYS_getcpu, &cpu, &linux_node, NULL) == 0) node = (int)linux_node;
+#endif
+    return node < NODE_ALLOC_MAX_NUMA_NODES ? node : -1;
+}
+
+int node_alloc_bind_thread(int numa_node) {
+    if (numa_node < 0) numa_node = node_alloc_current_numa_node();
+    else if (numa_node >= NODE_ALLOC_MAX_NUMA_NODES) numa_node = -1;
+    thread_arenas.numa_node = numa_node;
+    thread_arenas.bound = 1;
+    return numa_node >= 0 ? 0 : -1;
+}
+
+// ӳһ 2MB ʽҳ  ͸ҳLinux/ ͨҳWindows
+// Ҫʱڵһη֮ǰ󶨵ָ NUMA ڵ㣬numa_node Ϊ -1 ʱ
+static Region* map_region(int numa_node) {
+    int flags = alloc_flags.load(std::memory_order_relaxed);
+    int numa = (flags & NODE_ALLOC_NUMA_LOCAL) != 0 && numa_node >= 0;
+    char* p = NULL;
+    void* base = NULL;
+    size_t bytes = 0;
+    int explicit_pages = 0;
+#ifdef _WIN32
+    HANDLE proc = GetCurrentProcess();
+    DWORD preferred = numa ? (DWORD)numa_node : NUMA_NO_PREFERRED_NODE;
+    SIZE_T large = GetLargePageMinimum();
+    if ((flags & NODE_ALLOC_EXPLICIT_HUGEPAGES) && large && REGION_BYTES % large == 0) {
+        p = (char*)VirtualAllocExNuma(proc, NULL, REGION_BYTES,
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, preferred);
+        if (p) explicit_pages = 1;
+    }
+    // ͨҳȶԤһҶַͷźڶ봦·䣬߳ռʱ
+    for (int attempt = 0; !p && attempt < 8; attempt++) {
+        char* raw = (char*)VirtualAlloc(NULL, 2 * REGION_BYTES, MEM_RESERVE, PAGE_NOACCESS);
+        if (!raw) return NULL;
+        char* aligned = (char*)(((uintptr_t)raw + REGION_BYTES - 1) & ~(uintptr_t)(REGION_BYTES - 1));
+        VirtualFree(raw, 0, MEM_RELEASE);
+        p = (char*)VirtualAllocExNuma(proc, aligned, REGION_BYTES, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, preferred);
+    }
+    if (!p) return NULL;
+    base = p;
+    bytes = REGION_BYTES;
+#else
+#ifdef MAP_HUGETLB
+    if (flags & NODE_ALLOC_EXPLICIT_HUGEPAGES) {
+        void* m = mmap(NULL, REGION_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+        if (m != MAP_FAILED) {
+            p = (char*)m;
+            explicit_pages = 1;
+        }
+    }
+#endif
+    if (!p) {
+        void* m = mmap(NULL, 2 * REGION_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (m == MAP_FAILED) return NULL;
+        char* raw = (char*)m;
+        p = (char*)(((uintptr_t)raw + REGION_BYTES - 1) & ~(uintptr_t)(REGION_BYTES - 1));
+        if (p > raw) munmap(raw, p - raw);
+        if (raw + 2 * REGION_BYTES > p + REGION_BYTES) munmap(p + REGION_BYTES, raw + 2 * REGION_BYTES - (p + REGION_BYTES));
+#ifdef MADV_HUGEPAGE
+        madvise(p, REGION_BYTES, MADV_HUGEPAGE);
+#endif
+    }
+    base = p;
+    bytes = REGION_BYTES;
+#ifdef SYS_mbind
+    if (numa) {
+        unsigned long mask = 1ul << numa_node;
+        syscall(SYS_mbind, p, REGION_BYTES, MPOL_PREFERRED, &mask, NODE_ALLOC_MAX_NUMA_NODES + 1, 0);
+    }
+#endif
+#endif
+    Region* region = (Region*)p;
+    region->map_base = base;
+    region->map_bytes = bytes;
+    region->explicit_pages = explicit_pages;
+    region_count.fetch_add(1);
+    if (explicit_pages) explicit_region_count.fetch_add(1);
+    return region;
+}
+
+static void unmap_region(Region* region) {
+#ifdef _WIN32
+    VirtualFree(region->map_base, 0, MEM_RELEASE);
+#else
+    munmap(region->map_base, region->map_bytes);
+#endif
+}
+
+// ǰ߳ (numa_node, cls) ϵ arenaȽӹģû½
+static NodeArena* thread_arena(int numa_node, int cls) {
+    NodeArena* arena = thread_arenas.arenas[numa_node + 1][cls];
+    if (arena) return arena;
+
+    global_lock.lock();
+    for (NodeArena* a = all_arenas; a; a = a->next) {
+        int expected = 0;
+        if (a->numa_node == numa_node && a->slot_bytes == (size_t)(cls + 1) * SIZE_GRAIN &&
+            a->owned.compare_exchange_strong(expected, 1)) {
+            arena = a;
+            break;
+        }
+    }
+    if (!arena) {
+        arena = new NodeArena();
+        arena->slot_bytes = (size_t)(cls + 1) * SIZE_GRAIN;
+        arena->numa_node = numa_node;
+        arena->bump = NULL;
+        arena->bump_end = NULL;
+        arena->free_list = NULL;
+        arena->remote_free.store(NULL);
+        arena->owned.store(1);
+        arena->next = all_arenas;
+        all_arenas = arena;
+    }
+    global_lock.unlock();
+    thread_arenas.arenas[numa_node + 1][cls] = arena;
+    return arena;
+}
+
+static void* hugepage_alloc(size_t size) {
+    if (size == 0 || size > MAX_NODE_BYTES) return NULL;
+    if (!thread_arenas.bound) node_alloc_bind_thread(-1);
+    NodeArena* arena = thread_arena(thread_arenas.numa_node, (int)((size + SIZE_GRAIN - 1) / SIZE_GRAIN) - 1);
+
+    if (!arena->free_list && arena->remote_free.load(std::memory_order_relaxed))
+        arena->free_list = arena->remote_free.exchange(NULL, std::memory_order_acquire);
+    if (arena->free_list) {
+        void* p = arena->free_list;
+        arena->free_list = *(void**)p;
+        return p;
+    }
+    if (arena->bump + arena->slot_bytes > arena->bump_end) {
+        Region* region = map_region(arena->numa_node);
+        if (!region) return NULL;
+        region->arena = arena;
+        global_lock.lock();
+        region->next = all_regions;
+        all_regions = region;
+        global_lock.unlock();
+        arena->bump = (char*)region + REGION_HEADER_BYTES;
+        arena->bump_end = (char*)region + REGION_BYTES;
+    }
+    void* p = arena->bump;
+    arena->bump += arena->slot_bytes;
+    return p;
+}
+
+static void hugepage_free(void* ptr) {
+    if (!ptr) return;
+    Region* region = (Region*)((uintptr_t)ptr & ~(uintptr_t)(REGION_BYTES - 1));
+    NodeArena* arena = region->arena;
+    int cls = (int)(arena->slot_bytes / SIZE_GRAIN) - 1;
+    if (thread_arenas.arenas[arena->numa_node + 1][cls] == arena) {
+        *(void**)ptr = arena->free_list;
+        arena->free_list = ptr;
+        return;
+    }
+    // ֻȡߣᵥѹջû ABA 
+    void* head = arena->remote_free.load(std::memory_order_relaxed);
+    do {
+        *(void**)ptr = head;
+    } while (!arena->remote_free.compare_exchange_weak(head, ptr, std::memory_order_release, std::memory_order_relaxed));
+}
+
+static void* malloc_alloc(size_t size) {
+    return malloc(size);
+}
+
+static void malloc_free(void* ptr) {
+    free(ptr);
+}
+
+const NodeAllocBackend node_alloc_malloc_backend = { "malloc", malloc_alloc, malloc_free };
+const NodeAllocBackend node_alloc_hugepage_backend = { "hugepage", hugepage_alloc, hugepage_free };
+
+// ڵǽǰͷţԻдڵʱܾл malloc Ľڵ䵽 hugepage_free 
+int node_alloc_set_backend(const NodeAllocBackend* backend) {
+    if (!backend) backend = &node_alloc_malloc_backend;
+    if (backend == current_backend.load(std::memory_order_acquire)) return 0;
+    if (live_allocations() != 0) return -1;
+    current_backend.store(backend, std::memory_order_release);
+    return 0;
+}
+
+const NodeAllocBackend* node_alloc_get_backend(void) {
+    return current_backend.load(std::memory_order_acquire);
+}
+
+void node_alloc_set_flags(int flags) {
+    alloc_flags.store(flags, std::memory_order_relaxed);
+}
+
+void* node_alloc(size_t size) {
+    void* p = current_backend.load(std::memory_order_acquire)->alloc(size);
+    if (p) count_live(1);
+    return p;
+}
+
+void node_free(void* ptr) {
+    if (!ptr) return;
+    count_live(-1);
+    current_backend.load(std::memory_order_acquire)->free(ptr);
+}
+
+// arena ṹ̵߳ĻﻹָǣֻеͿ
+void node_alloc_release_all(void) {
+    global_lock.lock();
+    for (NodeArena* a = all_arenas; a; a = a->next) {
+        a->bump = NULL;
+        a->bump_end = NULL;
+        a->free_list = NULL;
+        a->remote_free.store(NULL);
+    }
+    Region* region = all_regions;
+    all_regions = NULL;
+    global_lock.unlock();
+
+    while (region) {
+        Region* next = region->next;
+        unmap_region(region);
+        region = next;
+    }
+    region_count.store(0);
+    explicit_region_count.store(0);
+}
+
+void node_alloc_region_stats(int* regions, int* explicit_regions) {
+    if (regions) *regions = region_count.load();
+    if (explicit_regions) *explicit_regions = explicit_region_count.load();
+}
+
+int dtlb_counter_start(void) {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0) return -1;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+long long dtlb_counter_stop(int counter) {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    if (counter < 0) return -1;
+    long long value = -1;
+    ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counter, &value, sizeof(value)) != (ssize_t)sizeof(value)) value = -1;
+    close(counter);
+    return value;
+#else
+    (void)counter;
+    return -1;
+#endif
+}
@@ -0,0 +1,63 @@
+/*********************************************************************
+ * Node allocator backend
+ * - create_node / createNode ͳһڵ
+ * - ĬϺΪ mallochugepage ˴ 2MB ҳзֽڵ㣬
+ *   Сּÿ̡߳ÿ NUMA ڵһ arena
+ * - ڵɵǰͷţдڵʱл
+ *********************************************************************/
+#ifndef DS_ALLOC_H
+#define DS_ALLOC_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct NodeAllocBackend {
+    const char* name;
+    void* (*alloc)(size_t size);
+    void (*free)(void* ptr);
+} NodeAllocBackend;
+
+/* hugepage ѡ */
+#define NODE_ALLOC_EXPLICIT_HUGEPAGES 0x1   /* ȳԤʽҳMAP_HUGETLB / MEM_LARGE_PAGESʧ˻͸ҳ */
+#define NODE_ALLOC_NUMA_LOCAL 0x2           /* 󶨵ǰ߳󶨵 NUMA ڵ */
+
+#define NODE_ALLOC_MAX_NUMA_NODES 8
+
+extern const NodeAllocBackend node_alloc_malloc_backend;
+extern const NodeAllocBackend node_alloc_hugepage_backend;
+
+/* ý̼ˣNULL ָΪ mallocо node_alloc 䡢δ node_free Ľڵʱܾл -1
+ * ɹ 0ʱ߳ڷͷŽڵ */
+int node_alloc_set_backend(const NodeAllocBackend* backend);
+const NodeAllocBackend* node_alloc_get_backend(void);
+
+void node_alloc_set_flags(int flags);
+
+/* ǰ֮߳ hugepage ŵ numa_node ϣ-1 ʾ̵߳ǰеĽڵ㡣
+ * ƬʱڲĳƬǰ󶨵÷ƬĽڵ㼴ɡ
+ * ڵų [0, NODE_ALLOC_MAX_NUMA_NODES) ޷ȷʱ NUMA 󶨲 -1򷵻 0 */
+int node_alloc_bind_thread(int numa_node);
+/* ǰ߳е NUMA ڵ㣬 NODE_ALLOC_MAX_NUMA_NODES ޷ȷʱ -1 */
+int node_alloc_current_numa_node(void);
+
+void* node_alloc(size_t size);
+void node_free(void* ptr);
+
+/*  hugepage ȫϵͳʱдĽڵ */
+void node_alloc_release_all(void);
+
+/* hugepage ӳʽҳӳĿ */
+void node_alloc_region_stats(int* regions, int* explicit_regions);
+
+/* ϣͳƵǰ߳û̬ dTLB ȱʧLinux perf_event֧ʱ start  -1stop  -1 */
+int dtlb_counter_start(void);
+long long dtlb_counter_stop(int counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -2,6 +2,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+
+#include "ds_alloc.h"
+#include "ds_threadpool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BPT_USE_SSE2 1
+#endif
 
 #define ORDER 4
 #define MIN_KEYS ((ORDER + 1) / 2 - 1)  // ORDER=4  1
@@ -14,13 +28,18 @@ typedef struct BPlusNode {
     int is_leaf;
 } BPlusNode;
 
+struct LearnedIndex;
+
 typedef struct BPlusTree {
     BPlusNode* root;
+    struct LearnedIndex* learned;   // ֻѧϰ/ɾʱʧЧ
 } BPlusTree;
 
+void drop_learned_index(BPlusTree* tree);
+
 // ڵ
 BPlusNode* create_node(int is_leaf) {
-    BPlusNode* node = (BPlusNode*)malloc(sizeof(BPlusNode));
+    BPlusNode* node = (BPlusNode*)node_alloc(sizeof(BPlusNode));
     if (!node) return NULL;
     memset(node, 0, sizeof(BPlusNode));
     node->is_leaf = is_leaf;
@@ -33,6 +52,7 @@ BPlusTree* create_tree() {
     BPlusTree* tree = (BPlusTree*)malloc(sizeof(BPlusTree));
     if (!tree) return NULL;
     tree->root = create_node(1);
+    tree->learned = NULL;
     return tree;
 }
 
@@ -110,6 +130,7 @@ void insert_into_parent(BPlusTree* tree, BPlusNode* parent, int up_key, BPlusNod
 // 
 void insert(BPlusTree* tree, int key) {
     if (!tree || !tree->root) return;
+    drop_learned_index(tree);
     int depth;
     BPlusNode** path;
     BPlusNode* leaf = find_leaf(tree, key, &path, &depth);
@@ -267,13 +288,14 @@ void merge_nodes(BPlusTree* tree, BPlusNode* parent, int merge_idx, BPlusNode* l
         for (int i = 0; i <= right->num_keys; i++)
             left->children[old + 1 + i] = right->children[i];
     }
-    free(right);
+    node_free(right);
     remove_from_internal(parent, merge_idx);
 }
 
 // ɾ
 void delete_key(BPlusTree* tree, int key) {
     if (!tree || !tree->root) return;
+    drop_learned_index(tree);
 
     int depth;
     BPlusNode** path;
@@ -340,11 +362,11 @@ void delete_key(BPlusTree* tree, int key) {
         BPlusNode* new_root = old_root->children[0];
         if (new_root) {
             tree->root = new_root;
-            free(old_root);
+            node_free(old_root);
         }
         else {
             // 
-            free(old_root);
+            node_free(old_root);
             tree->root = NULL;
         }
     }
@@ -353,8 +375,11 @@ void delete_key(BPlusTree* tree, int key) {
 }
 
 // ңذ key Ҷӽڵ㣬 NULL
+BPlusNode* learned_find_key(struct LearnedIndex* li, int key);
+
 BPlusNode* find_key(BPlusTree* tree, int key) {
     if (!tree || !tree->root) return NULL;
+    if (tree->learned) return learned_find_key(tree->learned, key);
     int depth;
     BPlusNode** path;
     BPlusNode* leaf = find_leaf(tree, key, &path, &depth);
@@ -365,6 +390,1310 @@ BPlusNode* find_key(BPlusTree* tree, int key) {
     return result;
 }
 
+// ͷݹͷŽڵ㣩
+void free_nodes(BPlusNode* node) {
+    if (!node) return;
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->num_keys; i++)
+            free_nodes(node->children[i]);
+    }
+    node_free(node);
+}
+
+void free_tree(BPlusTree* tree) {
+    if (!tree) return;
+    drop_learned_index(tree);
+    free_nodes(tree->root);
+    free(tree);
+}
+
+//   + ѧϰ 
+
+// ʱÿҶװļ num_keys == ORDER - 1 ʱѣ
+// ȶ״̬½ڵ ORDER - 2 Ҳֵܳ
+#define BULK_LEAF_FILL (ORDER - 2)
+#define BULK_FANOUT (ORDER - 1)
+
+// ѧϰϽ磺Ԥλʵλ֮ LEARNED_EPSILON
+#define LEARNED_EPSILON 16
+// αǰĻRadixSpline ѶεĶַΧСһͰڡ
+// λȡʹÿͰƽһΣ LEARNED_MAX_RADIX_BITS
+#define LEARNED_MAX_RADIX_BITS 16
+
+typedef struct LearnedSegment {
+    int first_key;      // ڵһ
+    int start;          // ڵһȫеλ
+    double slope;       // λ  start + slope * (key - first_key)
+} LearnedSegment;
+
+typedef struct LearnedIndex {
+    int* keys;                  // ҶӼֲ
+    int num_keys;
+    BPlusNode** leaves;         // ҶӰ˳У i λ leaves[i / BULK_LEAF_FILL]
+    int num_leaves;
+    LearnedSegment* segs;
+    int num_segs;
+    int* radix;                 // radix[r] = һǰ׺ >= r ĶΣ (1 << radix_bits) + 1 
+    int radix_bits;
+    int radix_shift;            // ǰ׺ = (key - keys[0]) >> radix_shift
+} LearnedIndex;
+
+#define BULK_CHUNK 4096     // йʱÿĽڵ
+
+typedef struct BulkJob {
+    const int* keys;
+    int n;
+    BPlusNode** level;      // ǰڵ
+    int* low;               // ÿС
+    int count;
+    BPlusNode** out;        // һڵ
+    int* out_low;
+    int parents;
+    std::atomic<int> failed;    // ڵʧܣʧλüΪ NULL
+} BulkJob;
+
+//  chunk Ҷӣڴ next֮ɵƴ
+static void bulk_leaf_task(void* arg, int chunk) {
+    BulkJob* job = (BulkJob*)arg;
+    int from = chunk * BULK_CHUNK;
+    int to = from + BULK_CHUNK < job->count ? from + BULK_CHUNK : job->count;
+    BPlusNode* prev = NULL;
+    for (int i = from; i < to; i++) {
+        BPlusNode* leaf = create_node(1);
+        job->level[i] = leaf;
+        if (!leaf) {
+            job->failed.store(1);
+            prev = NULL;
+            continue;
+        }
+        int base = i * BULK_LEAF_FILL;
+        for (int j = base; j < job->n && j < base + BULK_LEAF_FILL; j++)
+            leaf->keys[leaf->num_keys++] = job->keys[j];
+        if (prev) prev->next = leaf;
+        prev = leaf;
+        job->low[i] = leaf->keys[0];
+    }
+}
+
+//  p ڵӽڵ㷶Χÿ BULK_FANOUT һ飬һ鲻 2 ʱǰһһ
+static void bulk_group(int count, int parents, int p, int* start, int* take) {
+    *start = p * BULK_FANOUT;
+    *take = count - *start < BULK_FANOUT ? count - *start : BULK_FANOUT;
+    if (count % BULK_FANOUT == 1 && parents > 1) {
+        if (p == parents - 2) {
+            *take = BULK_FANOUT - 1;
+        }
+        else if (p == parents - 1) {
+            *start -= 1;
+            *take = 2;
+        }
+    }
+}
+
+static void bulk_parent_task(void* arg, int chunk) {
+    BulkJob* job = (BulkJob*)arg;
+    int from = chunk * BULK_CHUNK;
+    int to = from + BULK_CHUNK < job->parents ? from + BULK_CHUNK : job->parents;
+    for (int p = from; p < to; p++) {
+        int start, take;
+        bulk_group(job->count, job->parents, p, &start, &take);
+        BPlusNode* node = create_node(0);
+        job->out[p] = node;
+        if (!node) {
+            job->failed.store(1);
+            continue;
+        }
+        node->children[0] = job->level[start];
+        for (int c = 1; c < take; c++) {
+            node->keys[node->num_keys++] = job->low[start + c];
+            node->children[c] = job->level[start + c];
+        }
+        job->out_low[p] = job->low[start];
+    }
+}
+
+// ĳʧʱͷѽõĲ֣parents һڵֻͷ
+// ǰ count ͷ
+static BPlusTree* bulk_abort(BulkJob* job, BPlusTree* tree, int parents) {
+    for (int p = 0; p < parents; p++)
+        node_free(job->out[p]);
+    for (int i = 0; i < job->count; i++)
+        free_nodes(job->level[i]);
+    free(job->level);
+    free(job->low);
+    free(job->out);
+    free(job->out_low);
+    free(tree);
+    return NULL;
+}
+
+// 򣨷ǵݼļԵϹ B+ Ҷ BULK_LEAF_FILL 
+// ÿ㰴 BULK_CHUNK гɶ񽻸 poolpool Ϊ NULL ʱСڴ治ʱ NULL
+BPlusTree* parallel_bulk_load(ThreadPool* pool, const int* keys, int n) {
+    BPlusTree* tree = create_tree();
+    if (!tree || n <= 0) return tree;
+    node_free(tree->root);
+    tree->root = NULL;
+
+    BulkJob job;
+    job.keys = keys;
+    job.n = n;
+    job.count = (n + BULK_LEAF_FILL - 1) / BULK_LEAF_FILL;
+    job.level = (BPlusNode**)malloc(sizeof(BPlusNode*) * job.count);
+    job.low = (int*)malloc(sizeof(int) * job.count);
+    job.out = (BPlusNode**)malloc(sizeof(BPlusNode*) * job.count);
+    job.out_low = (int*)malloc(sizeof(int) * job.count);
+    job.failed.store(0);
+    if (!job.level || !job.low || !job.out || !job.out_low) {
+        free(job.level);
+        free(job.low);
+        free(job.out);
+        free(job.out_low);
+        free(tree);
+        return NULL;
+    }
+
+    int chunks = (job.count + BULK_CHUNK - 1) / BULK_CHUNK;
+    thread_pool_parallel_for(pool, chunks, bulk_leaf_task, &job);
+    if (job.failed.load()) return bulk_abort(&job, tree, 0);
+    for (int c = 1; c < chunks; c++)
+        job.level[c * BULK_CHUNK - 1]->next = job.level[c * BULK_CHUNK];
+
+    while (job.count > 1) {
+        job.parents = (job.count + BULK_FANOUT - 1) / BULK_FANOUT;
+        thread_pool_parallel_for(pool, (job.parents + BULK_CHUNK - 1) / BULK_CHUNK, bulk_parent_task, &job);
+        if (job.failed.load()) return bulk_abort(&job, tree, job.parents);
+        BPlusNode** nodes = job.level;
+        int* low = job.low;
+        job.level = job.out;
+        job.low = job.out_low;
+        job.out = nodes;
+        job.out_low = low;
+        job.count = job.parents;
+    }
+
+    tree->root = job.level[0];
+    free(job.level);
+    free(job.low);
+    free(job.out);
+    free(job.out_low);
+    return tree;
+}
+
+BPlusTree* bulk_load(const int* keys, int n) {
+    return parallel_bulk_load(NULL, keys, n);
+}
+
+// ׶shrinking coneֶϣÿбʱ֤еԤ  LEARNED_EPSILON
+static int fit_segments(const int* keys, int n, LearnedSegment* segs) {
+    int num_segs = 0;
+    int i = 0;
+    while (i < n) {
+        int k0 = keys[i], p0 = i;
+        double lo = 0.0, hi = 1e300;
+        int j = i + 1;
+        for (; j < n; j++) {
+            if (keys[j] == keys[j - 1]) continue;     // ظֻϵһγֵλ
+            double dk = (double)keys[j] - (double)k0;
+            double dp = (double)(j - p0);
+            double l = (dp - LEARNED_EPSILON) / dk;
+            double h = (dp + LEARNED_EPSILON) / dk;
+            if (l > hi || h < lo) break;
+            if (l > lo) lo = l;
+            if (h < hi) hi = h;
+        }
+        if (hi > 1e299) hi = lo;
+        segs[num_segs].first_key = k0;
+        segs[num_segs].start = p0;
+        segs[num_segs].slope = (lo + hi) / 2;
+        num_segs++;
+        i = j;
+    }
+    return num_segs;
+}
+
+//  [lo, hi) ͳ < key ļںС˳ɨȶָ
+static int count_less(const int* keys, int lo, int hi, int key) {
+    int cnt = 0;
+    int i = lo;
+#ifdef BPT_USE_SSE2
+    __m128i k = _mm_set1_epi32(key);
+    for (; i + 4 <= hi; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(keys + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(v, k)));
+        cnt += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+#endif
+    for (; i < hi; i++)
+        cnt += keys[i] < key;
+    return cnt;
+}
+
+// صһ >= key λ
+int learned_lower_bound(LearnedIndex* li, int key) {
+    if (key <= li->keys[0]) return 0;
+    unsigned int prefix = ((unsigned int)key - (unsigned int)li->keys[0]) >> li->radix_shift;
+    if (prefix >= (1u << li->radix_bits)) prefix = (1u << li->radix_bits) - 1;
+    int lo = li->radix[prefix], hi = li->radix[prefix + 1];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (li->segs[mid].first_key <= key) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return 0;
+
+    LearnedSegment* seg = &li->segs[lo - 1];
+    int end = lo < li->num_segs ? li->segs[lo].start : li->num_keys;
+    double guess = seg->start + seg->slope * ((double)key - (double)seg->first_key);
+    int pos = guess < seg->start ? seg->start : guess > end ? end : (int)guess;
+
+    int from = pos - LEARNED_EPSILON - 1;
+    int to = pos + LEARNED_EPSILON + 2;
+    if (from < seg->start) from = seg->start;
+    if (to > end) to = end;
+    int r = from + count_less(li->keys, from, to, key);
+    // ģֻԼظ״γλãظĲѯԽҶ
+    while (r == to && to < end) {
+        from = to;
+        to = to + 2 * LEARNED_EPSILON < end ? to + 2 * LEARNED_EPSILON : end;
+        r = from + count_less(li->keys, from, to, key);
+    }
+    return r;
+}
+
+BPlusNode* learned_find_key(LearnedIndex* li, int key) {
+    int pos = learned_lower_bound(li, key);
+    if (pos < li->num_keys && li->keys[pos] == key)
+        return li->leaves[pos / BULK_LEAF_FILL];
+    return NULL;
+}
+
+void drop_learned_index(BPlusTree* tree) {
+    LearnedIndex* li = tree->learned;
+    if (!li) return;
+    free(li->keys);
+    free(li->leaves);
+    free(li->segs);
+    free(li->radix);
+    free(li);
+    tree->learned = NULL;
+}
+
+// ҶϽѧϰ֮ find_key ģԤ + ֲ
+// ֻÿҶǡ BULK_LEAF_FILL һ⣩Ĳ֣򷵻 0
+int build_learned_index(BPlusTree* tree) {
+    if (!tree || !tree->root) return 0;
+    drop_learned_index(tree);
+
+    BPlusNode* leaf = tree->root;
+    while (!leaf->is_leaf) leaf = leaf->children[0];
+
+    int num_keys = 0, num_leaves = 0;
+    for (BPlusNode* p = leaf; p; p = p->next) {
+        if (p->next && p->num_keys != BULK_LEAF_FILL) return 0;
+        num_keys += p->num_keys;
+        num_leaves++;
+    }
+    if (num_keys == 0) return 0;
+
+    LearnedIndex* li = (LearnedIndex*)malloc(sizeof(LearnedIndex));
+    if (!li) return 0;
+    li->keys = (int*)malloc(sizeof(int) * num_keys);
+    li->leaves = (BPlusNode**)malloc(sizeof(BPlusNode*) * num_leaves);
+    li->segs = (LearnedSegment*)malloc(sizeof(LearnedSegment) * num_keys);
+    li->radix = NULL;
+    if (!li->keys || !li->leaves || !li->segs) {
+        free(li->keys);
+        free(li->leaves);
+        free(li->segs);
+        free(li);
+        return 0;
+    }
+    li->num_keys = num_keys;
+    li->num_leaves = num_leaves;
+
+    int k = 0, l = 0;
+    for (BPlusNode* p = leaf; p; p = p->next) {
+        li->leaves[l++] = p;
+        for (int i = 0; i < p->num_keys; i++)
+            li->keys[k++] = p->keys[i];
+    }
+
+    li->num_segs = fit_segments(li->keys, num_keys, li->segs);
+    LearnedSegment* shrunk = (LearnedSegment*)realloc(li->segs, sizeof(LearnedSegment) * li->num_segs);
+    if (shrunk) li->segs = shrunk;
+
+    li->radix_bits = 1;
+    while (li->radix_bits < LEARNED_MAX_RADIX_BITS && (1 << li->radix_bits) < li->num_segs) li->radix_bits++;
+    li->radix = (int*)malloc(sizeof(int) * ((1 << li->radix_bits) + 1));
+    if (!li->radix) {
+        tree->learned = li;
+        drop_learned_index(tree);
+        return 0;
+    }
+    unsigned int span = (unsigned int)li->keys[num_keys - 1] - (unsigned int)li->keys[0];
+    li->radix_shift = 0;
+    while ((span >> li->radix_shift) >= (1u << li->radix_bits)) li->radix_shift++;
+    int s = 0;
+    for (int r = 0; r <= (1 << li->radix_bits); r++) {
+        while (s < li->num_segs &&
+            (((unsigned int)li->segs[s].first_key - (unsigned int)li->keys[0]) >> li->radix_shift) < (unsigned int)r)
+            s++;
+        li->radix[r] = s;
+    }
+    tree->learned = li;
+    return 1;
+}
+
+// ѧϰ֮ռõֽ + Ҷӱ + ֶα + 
+size_t learned_index_bytes(BPlusTree* tree) {
+    if (!tree || !tree->learned) return 0;
+    LearnedIndex* li = tree->learned;
+    return sizeof(LearnedIndex) + sizeof(int) * li->num_keys + sizeof(BPlusNode*) * li->num_leaves +
+        sizeof(LearnedSegment) * li->num_segs + sizeof(int) * ((1 << li->radix_bits) + 1);
+}
+
+//  дʱƶ汾MVCC գ 
+
+#define MAX_SNAPSHOT_READERS 64
+
+// һѷİ汾retired ¼汾бһ汾滻Ľڵ㣬
+// Щڵֻб汾ɵİ汾ܿ汾ʱһͷ
+typedef struct TreeVersion {
+    BPlusNode* root;
+    BPlusNode** retired;
+    int num_retired;
+    struct TreeVersion* newer;
+} TreeVersion;
+
+// һдƵ·replaced[i] ǵǰ汾Ľڵ㣬copies[i] ĸ
+// °汾ɹ replaced Źҵɰ汾 retired 
+typedef struct CowPath {
+    BPlusNode** replaced;
+    BPlusNode** copies;
+    int count;
+} CowPath;
+
+// д·ƽڵ󷢲¸߹̶pinĳ汾ȡ
+// 汾Ӿɵ»գһԱ̶İ汾ֹͣд߷ʱͶ̶߽ʱա
+// ע⣺汾ģʽҶӵ next ɸ档δƵҶָɵֵܣ
+// Ǹֵܿѱ滻գждֻܴӸ children ½
+typedef struct VersionedTree {
+    std::atomic<TreeVersion*> current;
+    TreeVersion* oldest;                                    // ֻڳ write_lock ʱ
+    std::mutex write_lock;                                  // д֮䡢Լʱ
+    std::atomic<int> reclaim_pending;                       // ж̶߽û
+    std::atomic<TreeVersion*> pinned[MAX_SNAPSHOT_READERS];
+    std::atomic<int> slot_used[MAX_SNAPSHOT_READERS];
+} VersionedTree;
+
+static TreeVersion* create_version(BPlusNode* root) {
+    TreeVersion* v = (TreeVersion*)calloc(1, sizeof(TreeVersion));
+    if (!v) return NULL;
+    v->root = root;
+    return v;
+}
+
+static void free_version(TreeVersion* v) {
+    for (int i = 0; i < v->num_retired; i++)
+        node_free(v->retired[i]);
+    free(v->retired);
+    free(v);
+}
+
+// Ҷӵ next գ°汾ָ̳ܱյľֵָܵ
+static BPlusNode* clone_node(BPlusNode* node) {
+    BPlusNode* copy = (BPlusNode*)node_alloc(sizeof(BPlusNode));
+    if (!copy) return NULL;
+    memcpy(copy, node, sizeof(BPlusNode));
+    copy->next = NULL;
+    return copy;
+}
+
+static void cow_path_abort(CowPath* path) {
+    for (int i = 0; i < path->count; i++)
+        node_free(path->copies[i]);
+    free(path->replaced);
+    free(path->copies);
+}
+
+//  key Ĳ·ӸƵҶӣ¸with_siblings ʱ˳ÿ
+// ֵܣΪɾʱĽ/ϲдֵܡֱ֮ڸԭ㷨
+// 汾ģʽҶӵ next ٿɿɨ
+// ¼鰴һηãκһڴ治㶼ͷĸ NULLǰ汾ԭ
+static BPlusNode* cow_path(BPlusNode* root, int key, int with_siblings, CowPath* path) {
+    int height = 1;
+    for (BPlusNode* n = root; !n->is_leaf; n = n->children[0]) height++;
+    int cap = with_siblings ? 3 * height : height;
+    path->replaced = (BPlusNode**)malloc(sizeof(BPlusNode*) * cap);
+    path->copies = (BPlusNode**)malloc(sizeof(BPlusNode*) * cap);
+    path->count = 0;
+    if (!path->replaced || !path->copies) {
+        cow_path_abort(path);
+        return NULL;
+    }
+
+    BPlusNode* new_root = clone_node(root);
+    if (!new_root) {
+        cow_path_abort(path);
+        return NULL;
+    }
+    path->replaced[path->count] = root;
+    path->copies[path->count++] = new_root;
+    BPlusNode* cur = new_root;
+    while (!cur->is_leaf) {
+        int i = find_pos(cur, key);
+        int from = with_siblings && i > 0 ? i - 1 : i;
+        int to = with_siblings && i < cur->num_keys ? i + 1 : i;
+        for (int c = from; c <= to; c++) {
+            BPlusNode* copy = clone_node(cur->children[c]);
+            if (!copy) {
+                cow_path_abort(path);
+                return NULL;
+            }
+            path->replaced[path->count] = cur->children[c];
+            path->copies[path->count++] = copy;
+            cur->children[c] = copy;
+        }
+        cur = cur->children[i];
+    }
+    return new_root;
+}
+
+static void reclaim_versions(VersionedTree* vt) {
+    TreeVersion* cur = vt->current.load();
+    while (vt->oldest != cur) {
+        TreeVersion* v = vt->oldest;
+        for (int i = 0; i < MAX_SNAPSHOT_READERS; i++) {
+            if (vt->pinned[i].load() == v) return;
+        }
+        vt->oldest = v->newer;
+        free_version(v);
+    }
+}
+
+// д write_lock ʱաò˵һ̳߳
+// Ǹ߳ͷ֮ҲԽ̶󲻻ᶪ
+static void try_reclaim_versions(VersionedTree* vt) {
+    while (vt->reclaim_pending.load() && vt->write_lock.try_lock()) {
+        vt->reclaim_pending.store(0);
+        reclaim_versions(vt);
+        vt->write_lock.unlock();
+    }
+}
+
+static void write_unlock(VersionedTree* vt) {
+    vt->write_lock.unlock();
+    try_reclaim_versions(vt);
+}
+
+// v ڸ·֮ǰѷãԷʧܡ
+// ǰ汾 retired ǿյģ滻ĽڵŽ
+static void publish_version(VersionedTree* vt, TreeVersion* old, TreeVersion* v, BPlusNode* root, CowPath* path) {
+    v->root = root;
+    old->retired = path->replaced;
+    old->num_retired = path->count;
+    free(path->copies);
+    old->newer = v;
+    vt->current.store(v);
+    reclaim_versions(vt);
+}
+
+// ӹ base Ľڵ㣨ͨ bulk_loadbase ͷţڴ治ʱ NULLbase 
+VersionedTree* create_versioned_tree(BPlusTree* base) {
+    BPlusNode* root = base ? base->root : create_node(1);
+    if (!base && !root) return NULL;
+    TreeVersion* v = create_version(root);
+    if (!v) {
+        if (!base) node_free(root);
+        return NULL;
+    }
+    VersionedTree* vt = new VersionedTree();
+    if (base) {
+        drop_learned_index(base);
+        free(base);
+    }
+    vt->oldest = v;
+    vt->current.store(v);
+    vt->reclaim_pending.store(0);
+    for (int i = 0; i < MAX_SNAPSHOT_READERS; i++) {
+        vt->pinned[i].store(NULL);
+        vt->slot_used[i].store(0);
+    }
+    return vt;
+}
+
+void free_versioned_tree(VersionedTree* vt) {
+    if (!vt) return;
+    TreeVersion* cur = vt->current.load();
+    while (vt->oldest != cur) {
+        TreeVersion* v = vt->oldest;
+        vt->oldest = v->newer;
+        free_version(v);
+    }
+    free_nodes(cur->root);
+    free_version(cur);
+    delete vt;
+}
+
+//  path ֻ½
+static BPlusNode* descend(BPlusNode* cur, int key) {
+    while (!cur->is_leaf) cur = cur->children[find_pos(cur, key)];
+    return cur;
+}
+
+static int node_contains(BPlusNode* root, int key) {
+    if (!root) return 0;
+    BPlusNode* leaf = descend(root, key);
+    for (int i = 0; i < leaf->num_keys; i++) {
+        if (leaf->keys[i] == key) return 1;
+    }
+    return 0;
+}
+
+// ɹ 0ڴ治㷵 -1ʱûκα仯
+int versioned_insert(VersionedTree* vt, int key) {
+    vt->write_lock.lock();
+    TreeVersion* old = vt->current.load();
+    TreeVersion* v = create_version(NULL);
+    CowPath path = { NULL, NULL, 0 };
+    BPlusTree tmp;
+    tmp.learned = NULL;
+    tmp.root = NULL;
+    if (v) tmp.root = old->root ? cow_path(old->root, key, 0, &path) : create_node(1);
+    if (!tmp.root) {
+        free(v);
+        write_unlock(vt);
+        return -1;
+    }
+    insert(&tmp, key);
+    publish_version(vt, old, v, tmp.root, &path);
+    write_unlock(vt);
+    return 0;
+}
+
+// ɹڣ 0ڴ治㷵 -1ʱûκα仯
+int versioned_delete_key(VersionedTree* vt, int key) {
+    vt->write_lock.lock();
+    TreeVersion* old = vt->current.load();
+    if (!node_contains(old->root, key)) {
+        reclaim_versions(vt);
+        write_unlock(vt);
+        return 0;
+    }
+    TreeVersion* v = create_version(NULL);
+    CowPath path = { NULL, NULL, 0 };
+    BPlusTree tmp;
+    tmp.learned = NULL;
+    tmp.root = v ? cow_path(old->root, key, 1, &path) : NULL;
+    if (!tmp.root) {
+        free(v);
+        write_unlock(vt);
+        return -1;
+    }
+    delete_key(&tmp, key);
+    publish_version(vt, old, v, tmp.root, &path);
+    write_unlock(vt);
+    return 0;
+}
+
+// ߲λÿ߳עһΡλʱ -1̲߳ܶ
+int snapshot_reader_register(VersionedTree* vt) {
+    for (int i = 0; i < MAX_SNAPSHOT_READERS; i++) {
+        int expected = 0;
+        if (vt->slot_used[i].compare_exchange_strong(expected, 1)) return i;
+    }
+    return -1;
+}
+
+void snapshot_reader_unregister(VersionedTree* vt, int slot) {
+    if (slot < 0 || slot >= MAX_SNAPSHOT_READERS) return;
+    vt->pinned[slot].store(NULL);
+    vt->reclaim_pending.store(1);
+    try_reclaim_versions(vt);
+    vt->slot_used[slot].store(0);
+}
+
+// ̶ǰ汾ȹȷǵǰ汾ȷ֮д߲
+// slot Чʱ NULL
+TreeVersion* snapshot_pin(VersionedTree* vt, int slot) {
+    if (slot < 0 || slot >= MAX_SNAPSHOT_READERS) return NULL;
+    TreeVersion* v;
+    do {
+        v = vt->current.load();
+        vt->pinned[slot].store(v);
+    } while (vt->current.load() != v);
+    return v;
+}
+
+// ̶Իգصһд
+void snapshot_unpin(VersionedTree* vt, int slot) {
+    if (slot < 0 || slot >= MAX_SNAPSHOT_READERS) return;
+    vt->pinned[slot].store(NULL);
+    vt->reclaim_pending.store(1);
+    try_reclaim_versions(vt);
+}
+
+BPlusNode* snapshot_find_key(TreeVersion* v, int key) {
+    if (!v->root) return NULL;
+    BPlusNode* leaf = descend(v->root, key);
+    for (int i = 0; i < leaf->num_keys; i++) {
+        if (leaf->keys[i] == key) return leaf;
+    }
+    return NULL;
+}
+
+static void scan_nodes(BPlusNode* node, int lo, int hi, void (*visit)(int key, void* arg), void* arg) {
+    if (node->is_leaf) {
+        for (int i = 0; i < node->num_keys; i++) {
+            if (node->keys[i] >= lo && node->keys[i] <= hi) visit(node->keys[i], arg);
+        }
+        return;
+    }
+    for (int i = 0; i <= node->num_keys; i++) {
+        if (i < node->num_keys && node->keys[i] < lo) continue;
+        if (i > 0 && node->keys[i - 1] > hi) break;
+        scan_nodes(node->children[i], lo, hi, visit, arg);
+    }
+}
+
+// ʿ [lo, hi] ڵм
+void snapshot_scan(TreeVersion* v, int lo, int hi, void (*visit)(int key, void* arg), void* arg) {
+    if (v->root) scan_nodes(v->root, lo, hi, visit, arg);
+}
+
+//  й벢ۺ 
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+typedef struct RadixJob {
+    int* src;
+    int* dst;
+    int n;
+    int chunk;              // ÿԪ
+    int shift;
+    int (*hist)[RADIX_BUCKETS];     // hist[task][digit]ɨΪд
+} RadixJob;
+
+// λȡз޷Ŵ
+static inline int radix_digit(int key, int shift) {
+    return (int)((((unsigned int)key ^ 0x80000000u) >> shift) & (RADIX_BUCKETS - 1));
+}
+
+static void radix_count_task(void* arg, int t) {
+    RadixJob* job = (RadixJob*)arg;
+    int from = t * job->chunk;
+    int to = from + job->chunk < job->n ? from + job->chunk : job->n;
+    int* hist = job->hist[t];
+    memset(hist, 0, sizeof(int) * RADIX_BUCKETS);
+    for (int i = from; i < to; i++)
+        hist[radix_digit(job->src[i], job->shift)]++;
+}
+
+static void radix_scatter_task(void* arg, int t) {
+    RadixJob* job = (RadixJob*)arg;
+    int from = t * job->chunk;
+    int to = from + job->chunk < job->n ? from + job->chunk : job->n;
+    int* offs = job->hist[t];
+    for (int i = from; i < to; i++)
+        job->dst[offs[radix_digit(job->src[i], job->shift)]++] = job->src[i];
+}
+
+// LSD ÿ 8 λ 4 ˣͳԼǶεֱͼ
+// ÿ (Ͱ, ) д㣬ٲзַȶд keys
+int parallel_radix_sort(ThreadPool* pool, int* keys, int n) {
+    if (n <= 1) return 1;
+    int tasks = thread_pool_size(pool) * 4;
+    RadixJob job;
+    job.n = n;
+    job.chunk = (n + tasks - 1) / tasks;
+    tasks = (n + job.chunk - 1) / job.chunk;
+    job.hist = (int(*)[RADIX_BUCKETS])malloc(sizeof(int) * RADIX_BUCKETS * tasks);
+    int* tmp = (int*)malloc(sizeof(int) * n);
+    if (!job.hist || !tmp) {
+        free(job.hist);
+        free(tmp);
+        return 0;
+    }
+
+    job.src = keys;
+    job.dst = tmp;
+    for (job.shift = 0; job.shift < 32; job.shift += RADIX_BITS) {
+        thread_pool_parallel_for(pool, tasks, radix_count_task, &job);
+        int sum = 0;
+        for (int d = 0; d < RADIX_BUCKETS; d++) {
+            for (int t = 0; t < tasks; t++) {
+                int c = job.hist[t][d];
+                job.hist[t][d] = sum;
+                sum += c;
+            }
+        }
+        thread_pool_parallel_for(pool, tasks, radix_scatter_task, &job);
+        int* swap = job.src;
+        job.src = job.dst;
+        job.dst = swap;
+    }
+
+    free(job.hist);
+    free(tmp);
+    return 1;
+}
+
+// δļй  л  
+BPlusTree* parallel_build_tree(ThreadPool* pool, const int* keys, int n) {
+    int* sorted = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+    if (!sorted) return NULL;
+    if (n > 0) memcpy(sorted, keys, sizeof(int) * n);
+    BPlusTree* tree = parallel_radix_sort(pool, sorted, n) ? parallel_bulk_load(pool, sorted, n) : NULL;
+    free(sorted);
+    return tree;
+}
+
+typedef struct RangeAggregate {
+    long long count;
+    long long sum;
+    int min;
+    int max;
+} RangeAggregate;
+
+static void aggregate_init(RangeAggregate* agg) {
+    agg->count = 0;
+    agg->sum = 0;
+    agg->min = 0;
+    agg->max = 0;
+}
+
+static void aggregate_merge(RangeAggregate* into, const RangeAggregate* from) {
+    if (!from->count) return;
+    if (!into->count || from->min < into->min) into->min = from->min;
+    if (!into->count || from->max > into->max) into->max = from->max;
+    into->count += from->count;
+    into->sum += from->sum;
+}
+
+//  scan_nodes ͬļ֦
+static void aggregate_nodes(BPlusNode* node, int lo, int hi, RangeAggregate* agg) {
+    if (node->is_leaf) {
+        for (int i = 0; i < node->num_keys; i++) {
+            int k = node->keys[i];
+            if (k < lo || k > hi) continue;
+            if (!agg->count || k < agg->min) agg->min = k;
+            if (!agg->count || k > agg->max) agg->max = k;
+            agg->count++;
+            agg->sum += k;
+        }
+        return;
+    }
+    for (int i = 0; i <= node->num_keys; i++) {
+        if (i < node->num_keys && node->keys[i] < lo) continue;
+        if (i > 0 && node->keys[i - 1] > hi) break;
+        aggregate_nodes(node->children[i], lo, hi, agg);
+    }
+}
+
+//  [lo, hi] ڵļ͡Сֵֵcount Ϊ 0 ʱ min/max 
+void range_aggregate(BPlusTree* tree, int lo, int hi, RangeAggregate* out) {
+    aggregate_init(out);
+    if (tree && tree->root) aggregate_nodes(tree->root, lo, hi, out);
+}
+
+long long count_range(BPlusTree* tree, int lo, int hi) {
+    RangeAggregate agg;
+    range_aggregate(tree, lo, hi, &agg);
+    return agg.count;
+}
+
+typedef struct AggregateJob {
+    BPlusNode** frontier;
+    RangeAggregate* parts;
+    int lo, hi;
+} AggregateJob;
+
+static void aggregate_task(void* arg, int i) {
+    AggregateJob* job = (AggregateJob*)arg;
+    aggregate_init(&job->parts[i]);
+    aggregate_nodes(job->frontier[i], job->lo, job->hi, &job->parts[i]);
+}
+
+// Ӹʼչֱཻ㹻ָ̣߳
+// ÿһ˳ϲ
+void parallel_range_aggregate(ThreadPool* pool, BPlusTree* tree, int lo, int hi, RangeAggregate* out) {
+    aggregate_init(out);
+    if (!tree || !tree->root) return;
+
+    int want = thread_pool_size(pool) * 8;
+    int cap = want * ORDER;
+    BPlusNode** frontier = (BPlusNode**)malloc(sizeof(BPlusNode*) * cap);
+    BPlusNode** next = (BPlusNode**)malloc(sizeof(BPlusNode*) * cap);
+    RangeAggregate* parts = (RangeAggregate*)malloc(sizeof(RangeAggregate) * cap);
+    if (!frontier || !next || !parts) {
+        free(frontier);
+        free(next);
+        free(parts);
+        aggregate_nodes(tree->root, lo, hi, out);
+        return;
+    }
+
+    int count = 1;
+    frontier[0] = tree->root;
+    while (count < want && !frontier[0]->is_leaf) {
+        int n = 0;
+        for (int f = 0; f < count; f++) {
+            BPlusNode* node = frontier[f];
+            for (int i = 0; i <= node->num_keys; i++) {
+                if (i < node->num_keys && node->keys[i] < lo) continue;
+                if (i > 0 && node->keys[i - 1] > hi) break;
+                next[n++] = node->children[i];
+            }
+        }
+        BPlusNode** swap = frontier;
+        frontier = next;
+        next = swap;
+        count = n;
+        if (count == 0) break;
+    }
+
+    AggregateJob job = { frontier, parts, lo, hi };
+    thread_pool_parallel_for(pool, count, aggregate_task, &job);
+    for (int i = 0; i < count; i++)
+        aggregate_merge(out, &parts[i]);
+
+    free(frontier);
+    free(next);
+    free(parts);
+}
+
+long long parallel_count_range(ThreadPool* pool, BPlusTree* tree, int lo, int hi) {
+    RangeAggregate agg;
+    parallel_range_aggregate(pool, tree, lo, hi, &agg);
+    return agg.count;
+}
+
+//  䳤ַǰ׺ѹ 
+
+// ַڵǶҳ data ͷѴβǰ
+// ڵмĹǰ׺ֻһΣڶĩβ¼ȥǰ׺ĺ׺
+// Լ׺ǰ STR_HEAD_BYTES ֽƴɵ headȽʱȱ head
+#define STR_NODE_BYTES 4096
+#define STR_MAX_KEY 255
+#define STR_HEAD_BYTES 4
+#define STR_MAX_DEPTH 64
+
+typedef struct StrSlot {
+    unsigned int head;          // ׺ǰ 4 ֽڰƴӣ㲹 0
+    unsigned short offset;      // ׺ data еλ
+    unsigned short len;         // ׺
+} StrSlot;
+
+// ڲڵĲۺҲຢָ룺 i ۴ children[i + 1]children[0]  first_child
+typedef struct StrInnerSlot {
+    StrSlot slot;
+    struct StrNode* child;
+} StrInnerSlot;
+
+#define STR_DATA_BYTES (STR_NODE_BYTES - 2 * sizeof(void*) - 4 * sizeof(unsigned short))
+
+typedef struct StrNode {
+    unsigned short is_leaf;
+    unsigned short num_keys;
+    unsigned short prefix_len;
+    unsigned short heap_start;  // data[heap_start, STR_DATA_BYTES) Ϊ
+    struct StrNode* next;       // Ҷʹ
+    struct StrNode* first_child;
+    unsigned char data[STR_DATA_BYTES];
+} StrNode;
+
+static_assert(sizeof(StrNode) == STR_NODE_BYTES, "StrNode must fill exactly one page");
+
+typedef struct StrBPlusTree {
+    StrNode* root;
+    int compress;               // 0 ʱǰ׺ѹͷָضϣڶԱ
+} StrBPlusTree;
+
+typedef struct StrKey {
+    const unsigned char* ptr;
+    int len;
+} StrKey;
+
+static StrNode* str_create_node(int is_leaf) {
+    StrNode* node = (StrNode*)node_alloc(sizeof(StrNode));
+    if (!node) return NULL;
+    node->is_leaf = (unsigned short)is_leaf;
+    node->num_keys = 0;
+    node->prefix_len = 0;
+    node->heap_start = STR_DATA_BYTES;
+    node->next = NULL;
+    node->first_child = NULL;
+    return node;
+}
+
+StrBPlusTree* str_create_tree(int compress) {
+    StrBPlusTree* tree = (StrBPlusTree*)malloc(sizeof(StrBPlusTree));
+    if (!tree) return NULL;
+    tree->root = str_create_node(1);
+    tree->compress = compress;
+    return tree;
+}
+
+static void str_free_nodes(StrNode* node) {
+    if (!node) return;
+    if (!node->is_leaf) {
+        str_free_nodes(node->first_child);
+        for (int i = 0; i < node->num_keys; i++)
+            str_free_nodes(((StrInnerSlot*)node->data)[i].child);
+    }
+    node_free(node);
+}
+
+void str_free_tree(StrBPlusTree* tree) {
+    if (!tree) return;
+    str_free_nodes(tree->root);
+    free(tree);
+}
+
+static int str_entry_size(int is_leaf) {
+    return is_leaf ? (int)sizeof(StrSlot) : (int)sizeof(StrInnerSlot);
+}
+
+static StrSlot* str_slot(StrNode* node, int i) {
+    return (StrSlot*)(node->data + i * str_entry_size(node->is_leaf));
+}
+
+static StrNode* str_child(StrNode* node, int i) {
+    return i == 0 ? node->first_child : ((StrInnerSlot*)node->data)[i - 1].child;
+}
+
+static unsigned int str_head(const unsigned char* s, int len) {
+    unsigned int head = 0;
+    for (int i = 0; i < STR_HEAD_BYTES; i++)
+        head = (head << 8) | (i < len ? s[i] : 0);
+    return head;
+}
+
+static int str_cmp(const unsigned char* a, int alen, const unsigned char* b, int blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    return c ? c : alen - blen;
+}
+
+static int str_lcp(const unsigned char* a, int alen, const unsigned char* b, int blen) {
+    int n = alen < blen ? alen : blen;
+    int i = 0;
+    while (i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+// upper Ϊ 1 ʱ <= key ļڲڵѡӣ򷵻 < key ļ
+// exact Ϊ pos Ƿ key
+static int str_search(StrNode* node, const unsigned char* key, int len, int upper, int* exact) {
+    *exact = 0;
+    const unsigned char* prefix = node->data + STR_DATA_BYTES - node->prefix_len;
+    int p = node->prefix_len;
+    if (p) {
+        int c = memcmp(key, prefix, len < p ? len : p);
+        if (c < 0 || (c == 0 && len < p)) return 0;
+        if (c > 0) return node->num_keys;
+    }
+    const unsigned char* suf = key + p;
+    int slen = len - p;
+    unsigned int head = str_head(suf, slen);
+
+    int lo = 0, hi = node->num_keys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        StrSlot* s = str_slot(node, mid);
+        int c = s->head != head ? (s->head < head ? -1 : 1)
+            : str_cmp(node->data + s->offset, s->len, suf, slen);
+        if (c < 0 || (upper && c == 0)) lo = mid + 1;
+        else hi = mid;
+    }
+    if (!upper && lo < node->num_keys) {
+        StrSlot* s = str_slot(node, lo);
+        *exact = s->head == head && str_cmp(node->data + s->offset, s->len, suf, slen) == 0;
+    }
+    return lo;
+}
+
+// ذ key Ҷӣ NULL
+StrNode* str_find_key(StrBPlusTree* tree, const char* key) {
+    if (!tree || !tree->root) return NULL;
+    const unsigned char* k = (const unsigned char*)key;
+    int len = (int)strlen(key);
+    int exact;
+    StrNode* cur = tree->root;
+    while (!cur->is_leaf)
+        cur = str_child(cur, str_search(cur, k, len, 1, &exact));
+    str_search(cur, k, len, 0, &exact);
+    return exact ? cur : NULL;
+}
+
+// key нڵǰ׺ʣռ乻ʱ߿·
+static int str_node_fits_fast(StrNode* node, const unsigned char* key, int len) {
+    int p = node->prefix_len;
+    if (len < p || memcmp(key, node->data + STR_DATA_BYTES - p, p) != 0) return 0;
+    return node->heap_start - (node->num_keys + 1) * str_entry_size(node->is_leaf) >= len - p;
+}
+
+// ·ԭز룬Ųʱ 0 ؽ
+static int str_node_insert_fast(StrNode* node, int pos, const unsigned char* key, int len, StrNode* right) {
+    if (!str_node_fits_fast(node, key, len)) return 0;
+    int p = node->prefix_len;
+    int esize = str_entry_size(node->is_leaf);
+    int slen = len - p;
+    node->heap_start = (unsigned short)(node->heap_start - slen);
+    memcpy(node->data + node->heap_start, key + p, slen);
+    memmove(node->data + (pos + 1) * esize, node->data + pos * esize, (node->num_keys - pos) * esize);
+    StrSlot* s = str_slot(node, pos);
+    s->head = str_head(key + p, slen);
+    s->offset = node->heap_start;
+    s->len = (unsigned short)slen;
+    if (!node->is_leaf) ((StrInnerSlot*)node->data)[pos].child = right;
+    node->num_keys++;
+    return 1;
+}
+
+// ǰ׺ѹֽ
+static int str_encoded_size(const StrKey* keys, int n, int is_leaf, int compress) {
+    if (n == 0) return 0;
+    int p = compress ? str_lcp(keys[0].ptr, keys[0].len, keys[n - 1].ptr, keys[n - 1].len) : 0;
+    int size = p + n * str_entry_size(is_leaf);
+    for (int i = 0; i < n; i++) size += keys[i].len - p;
+    return size;
+}
+
+//  keysڲڵ n + 1 ӣд node֤߱ŵ
+static void str_node_encode(StrNode* node, const StrKey* keys, StrNode* const* children, int n, int compress) {
+    int p = n && compress ? str_lcp(keys[0].ptr, keys[0].len, keys[n - 1].ptr, keys[n - 1].len) : 0;
+    int top = STR_DATA_BYTES - p;
+    memcpy(node->data + top, keys[0].ptr, p);
+    node->prefix_len = (unsigned short)p;
+    node->num_keys = (unsigned short)n;
+    if (!node->is_leaf) node->first_child = children[0];
+    for (int i = 0; i < n; i++) {
+        int slen = keys[i].len - p;
+        top -= slen;
+        memcpy(node->data + top, keys[i].ptr + p, slen);
+        StrSlot* s = str_slot(node, i);
+        s->head = str_head(keys[i].ptr + p, slen);
+        s->offset = (unsigned short)top;
+        s->len = (unsigned short)slen;
+        if (!node->is_leaf) ((StrInnerSlot*)node->data)[i].child = children[i + 1];
+    }
+    node->heap_start = (unsigned short)top;
+}
+
+// Ҷӷʱķָright ǰ׺Դ left׺ضϣ
+static int str_separator_len(const StrKey* left, const StrKey* right, int compress) {
+    if (!compress) return right->len;
+    return str_lcp(left->ptr, left->len, right->ptr, right->len) + 1;
+}
+
+// ѡѵ㣺߶Ҫŵ£м 1/4 Χѡ̵λ
+static int str_choose_split(const StrKey* keys, int n, int is_leaf, int compress) {
+    int first = 1, last = is_leaf ? n - 1 : n - 2;
+    int mid = n / 2, window = n / 8;
+    int best = -1, best_len = 0, best_dist = 0;
+    for (int s = first; s <= last; s++) {
+        int right_from = is_leaf ? s : s + 1;
+        if (str_encoded_size(keys, s, is_leaf, compress) > (int)STR_DATA_BYTES) continue;
+        if (str_encoded_size(keys + right_from, n - right_from, is_leaf, compress) > (int)STR_DATA_BYTES) continue;
+        int dist = s > mid ? s - mid : mid - s;
+        int sep = is_leaf ? str_separator_len(&keys[s - 1], &keys[s], compress) : keys[s].len;
+        // ֻеԶȽ
+        if (dist > window) sep = STR_MAX_KEY + dist;
+        if (best < 0 || sep < best_len || (sep == best_len && dist < best_dist)) {
+            best = s;
+            best_len = sep;
+            best_dist = dist;
+        }
+    }
+    return best;
+}
+
+// ·һļƻڵɵѼ¼ӡѵԤȽõֵܡ
+// һķֱָָ򱾲 scratch scratch Ҫд
+typedef struct StrLevelPlan {
+    StrNode* node;
+    unsigned char* scratch;
+    StrKey* keys;
+    StrNode** children;
+    int n;
+    int split;                  // -1 ʾдŵ£
+    int up_len;
+    StrNode* sibling;
+} StrLevelPlan;
+
+//  node  pos  keyڲڵͬʱҺ rightڴ治㷵 -1
+static int str_plan_decode(StrLevelPlan* pl, StrNode* node, int pos, const unsigned char* key, int len, StrNode* right) {
+    int n = node->num_keys + 1;
+    int esize = str_entry_size(node->is_leaf);
+    pl->node = node;
+    pl->n = n;
+    pl->split = -1;
+    pl->sibling = NULL;
+    pl->scratch = (unsigned char*)malloc((size_t)n * STR_MAX_KEY);
+    pl->keys = (StrKey*)malloc(sizeof(StrKey) * n);
+    pl->children = (StrNode**)malloc(sizeof(StrNode*) * (n + 1));
+    if (!pl->scratch || !pl->keys || !pl->children) return -1;
+
+    const unsigned char* prefix = node->data + STR_DATA_BYTES - node->prefix_len;
+    unsigned char* w = pl->scratch;
+    for (int i = 0, j = 0; i < n; i++) {
+        if (i == pos) {
+            pl->keys[i].ptr = key;
+            pl->keys[i].len = len;
+            if (!node->is_leaf) pl->children[i + 1] = right;
+            continue;
+        }
+        StrSlot* s = (StrSlot*)(node->data + j * esize);
+        memcpy(w, prefix, node->prefix_len);
+        memcpy(w + node->prefix_len, node->data + s->offset, s->len);
+        pl->keys[i].ptr = w;
+        pl->keys[i].len = node->prefix_len + s->len;
+        w += pl->keys[i].len;
+        if (!node->is_leaf) pl->children[i + 1] = ((StrInnerSlot*)node->data)[j].child;
+        j++;
+    }
+    if (!node->is_leaf) pl->children[0] = node->first_child;
+    return 0;
+}
+
+static void str_plan_free(StrLevelPlan* plans, int levels, int keep_siblings) {
+    for (int i = 0; i < levels; i++) {
+        free(plans[i].scratch);
+        free(plans[i].keys);
+        free(plans[i].children);
+        if (!keep_siblings) node_free(plans[i].sibling);
+    }
+}
+
+// ƻдһ
+static void str_plan_apply(StrLevelPlan* pl, int compress) {
+    StrNode* cur = pl->node;
+    int s = pl->split;
+    if (s < 0) {
+        str_node_encode(cur, pl->keys, pl->children, pl->n, compress);
+    }
+    else if (cur->is_leaf) {
+        str_node_encode(pl->sibling, pl->keys + s, NULL, pl->n - s, compress);
+        str_node_encode(cur, pl->keys, NULL, s, compress);
+        pl->sibling->next = cur->next;
+        cur->next = pl->sibling;
+    }
+    else {
+        str_node_encode(pl->sibling, pl->keys + s + 1, pl->children + s + 1, pl->n - s - 1, compress);
+        str_node_encode(cur, pl->keys, pl->children, s, compress);
+    }
+}
+
+//  C ַ1 ɹ0 Ѵڣ-1 ڴ治㣨ʱûκα仯
+// ·¶ϰҪдÿһ롢ѡ÷ѵ㡢ֵܺ¸
+// ȫɹ֮ſʼдڵ㣬;ʧܲ°ѵ
+int str_insert(StrBPlusTree* tree, const char* key) {
+    if (!tree || !tree->root) return -1;
+    int len = (int)strlen(key);
+    if (len > STR_MAX_KEY) return -1;
+
+    StrNode* path[STR_MAX_DEPTH];
+    int depth = 0, exact;
+    const unsigned char* k = (const unsigned char*)key;
+    StrNode* cur = tree->root;
+    while (!cur->is_leaf) {
+        path[depth++] = cur;
+        cur = str_child(cur, str_search(cur, k, len, 1, &exact));
+    }
+    int pos = str_search(cur, k, len, 0, &exact);
+    if (exact) return 0;
+    if (str_node_insert_fast(cur, pos, k, len, NULL)) return 1;
+
+    StrLevelPlan plans[STR_MAX_DEPTH + 1];
+    int levels = 0, failed = 0;
+    StrNode* right = NULL;
+    StrNode* fast_node = NULL;  // ͣܿٲ
+    StrNode* new_root = NULL;   // һֱ
+    for (;;) {
+        if (levels > 0 && str_node_fits_fast(cur, k, len)) {
+            fast_node = cur;
+            break;
+        }
+        StrLevelPlan* pl = &plans[levels++];
+        if (str_plan_decode(pl, cur, pos, k, len, right) < 0) {
+            failed = 1;
+            break;
+        }
+        if (str_encoded_size(pl->keys, pl->n, cur->is_leaf, tree->compress) <= (int)STR_DATA_BYTES) break;
+
+        int s = str_choose_split(pl->keys, pl->n, cur->is_leaf, tree->compress);
+        if (s >= 0) pl->sibling = str_create_node(cur->is_leaf);
+        if (!pl->sibling) {
+            failed = 1;
+            break;
+        }
+        pl->split = s;
+        pl->up_len = cur->is_leaf ? str_separator_len(&pl->keys[s - 1], &pl->keys[s], tree->compress)
+            : pl->keys[s].len;
+
+        k = pl->keys[s].ptr;
+        len = pl->up_len;
+        right = pl->sibling;
+        if (depth == 0) {
+            new_root = str_create_node(0);
+            if (!new_root) failed = 1;
+            break;
+        }
+        cur = path[--depth];
+        pos = str_search(cur, k, len, 1, &exact);
+    }
+    if (failed) {
+        str_plan_free(plans, levels, 0);
+        return -1;
+    }
+
+    // ￪ʼʧ
+    for (int i = 0; i < levels; i++)
+        str_plan_apply(&plans[i], tree->compress);
+    if (fast_node) {
+        str_node_insert_fast(fast_node, pos, k, len, right);
+    }
+    else if (new_root) {
+        new_root->first_child = tree->root;
+        str_node_insert_fast(new_root, 0, k, len, right);
+        tree->root = new_root;
+    }
+    str_plan_free(plans, levels, 1);
+    return 1;
+}
+
+typedef struct StrTreeStats {
+    long long nodes;
+    long long leaves;
+    long long keys;             // Ҷеļ
+    long long separator_bytes;  // ڲڵָ֮
+    long long separators;
+    int height;
+} StrTreeStats;
+
+static void str_collect_stats(StrNode* node, int level, StrTreeStats* st) {
+    st->nodes++;
+    if (level + 1 > st->height) st->height = level + 1;
+    if (node->is_leaf) {
+        st->leaves++;
+        st->keys += node->num_keys;
+        return;
+    }
+    for (int i = 0; i < node->num_keys; i++) {
+        st->separator_bytes += node->prefix_len + str_slot(node, i)->len;
+        st->separators++;
+    }
+    for (int i = 0; i <= node->num_keys; i++)
+        str_collect_stats(str_child(node, i), level + 1, st);
+}
+
+void str_tree_stats(StrBPlusTree* tree, StrTreeStats* st) {
+    memset(st, 0, sizeof(*st));
+    if (tree && tree->root) str_collect_stats(tree->root, 0, st);
+}
+
 // ӡĽ棬
 void print_tree(BPlusNode* node, int level) {
     if (!node) return;
@@ -381,7 +1710,423 @@ void print_tree(BPlusNode* node, int level) {
     }
 }
 
-int main() {
+//  ׼ 
+
+static unsigned int bench_rng = 2463534242u;
+
+// xorshift32MSVC  rand() ֻ 15 λɴΧ
+static unsigned int bench_rand(void) {
+    bench_rng ^= bench_rng << 13;
+    bench_rng ^= bench_rng >> 17;
+    bench_rng ^= bench_rng << 5;
+    return bench_rng;
+}
+
+static double elapsed_ms(clock_t start) {
+    return (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+}
+
+// ʱ󲿷ּСżͻĳ
+static void gen_timestamps(int* keys, int n) {
+    int t = 1500000000;
+    for (int i = 0; i < n; i++) {
+        unsigned int r = bench_rand();
+        t += (r % 100 < 95) ? 1 + (int)(r >> 8) % 16 : 1 + (int)(r >> 8) % 2000;
+        keys[i] = t;
+    }
+}
+
+//  + ն 1..1000 μ 1..100000
+static void gen_sequential_gaps(int* keys, int n) {
+    int k = 0, i = 0;
+    while (i < n) {
+        int run = 1 + (int)(bench_rand() % 1000);
+        for (int j = 0; j < run && i < n; j++)
+            keys[i++] = k++;
+        k += 1 + (int)(bench_rand() % 100000);
+    }
+}
+
+static size_t count_node_bytes(BPlusNode* node) {
+    if (!node) return 0;
+    size_t bytes = sizeof(BPlusNode);
+    if (!node->is_leaf) {
+        for (int i = 0; i <= node->num_keys; i++)
+            bytes += count_node_bytes(node->children[i]);
+    }
+    return bytes;
+}
+
+static void bench_learned_dataset(const char* name, void (*gen)(int*, int), int n, int lookups) {
+    int* keys = (int*)malloc(sizeof(int) * n);
+    int* queries = (int*)malloc(sizeof(int) * lookups);
+    if (!keys || !queries) {
+        free(keys);
+        free(queries);
+        return;
+    }
+    gen(keys, n);
+    // һмһڼڵֵ
+    unsigned int span = (unsigned int)(keys[n - 1] - keys[0]) + 1;
+    for (int i = 0; i < lookups; i++) {
+        queries[i] = (i & 1) ? keys[bench_rand() % n] : keys[0] + (int)(bench_rand() % span);
+    }
+
+    clock_t t0 = clock();
+    BPlusTree* tree = bulk_load(keys, n);
+    double load_ms = elapsed_ms(t0);
+
+    t0 = clock();
+    int hits_tree = 0;
+    for (int i = 0; i < lookups; i++)
+        hits_tree += find_key(tree, queries[i]) != NULL;
+    double tree_ms = elapsed_ms(t0);
+
+    t0 = clock();
+    build_learned_index(tree);
+    double model_ms = elapsed_ms(t0);
+
+    t0 = clock();
+    int hits_learned = 0;
+    for (int i = 0; i < lookups; i++)
+        hits_learned += find_key(tree, queries[i]) != NULL;
+    double learned_ms = elapsed_ms(t0);
+
+    printf("%s: %d keys, %d lookups\n", name, n, lookups);
+    printf("  pointer tree : build %8.1f ms, nodes %8zu KB, lookup %7.1f ns, hits %d\n",
+        load_ms, count_node_bytes(tree->root) / 1024, tree_ms * 1e6 / lookups, hits_tree);
+    printf("  learned index: build %8.1f ms, extra %8zu KB (%d segs), lookup %7.1f ns, hits %d%s\n",
+        model_ms, learned_index_bytes(tree) / 1024, tree->learned ? tree->learned->num_segs : 0,
+        learned_ms * 1e6 / lookups, hits_learned, hits_learned == hits_tree ? "" : "  MISMATCH");
+
+    free_tree(tree);
+    free(keys);
+    free(queries);
+}
+
+int bench_learned(void) {
+    const int n = 4000000, lookups = 2000000;
+    bench_learned_dataset("timestamps", gen_timestamps, n, lookups);
+    bench_learned_dataset("sequential-with-gaps", gen_sequential_gaps, n, lookups);
+    return 0;
+}
+
+static double now_ms(void) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+typedef struct ScanCheck {
+    long long count;
+    int last;
+    int unordered;
+} ScanCheck;
+
+static void scan_check_visit(int key, void* arg) {
+    ScanCheck* c = (ScanCheck*)arg;
+    if (c->count > 0 && key < c->last) c->unordered = 1;
+    c->last = key;
+    c->count++;
+}
+
+typedef struct MvccBenchResult {
+    long long writes;
+    long long scans;
+    long long bad_scans;
+    double scan_ms_total;
+    double scan_ms_max;
+} MvccBenchResult;
+
+// д߲ͣزɾһκһµĿնֻ n  n + 1 
+static void bench_mvcc_run(int versioned, int n, int readers, double duration_ms, MvccBenchResult* res) {
+    memset(res, 0, sizeof(*res));
+    int* keys = (int*)malloc(sizeof(int) * n);
+    if (!keys) return;
+    for (int i = 0; i < n; i++) keys[i] = i * 2;
+
+    BPlusTree* tree = bulk_load(keys, n);
+    VersionedTree* vt = versioned ? create_versioned_tree(tree) : NULL;
+    if (versioned && !vt) {
+        free_tree(tree);
+        free(keys);
+        return;
+    }
+    std::shared_timed_mutex tree_lock;  // ǰ汾ģʽɨڼֹд߱
+    std::atomic<int> stop(0);
+    std::mutex res_lock;
+
+    std::thread writer([&]() {
+        unsigned int rng = 12345;
+        long long ops = 0;
+        while (!stop.load()) {
+            rng = rng * 1103515245u + 12345u;
+            int key = (int)((rng >> 1) % (unsigned int)n) * 2 + 1;
+            if (versioned) {
+                versioned_insert(vt, key);
+                versioned_delete_key(vt, key);
+            }
+            else {
+                tree_lock.lock();
+                insert(tree, key);
+                tree_lock.unlock();
+                tree_lock.lock();
+                delete_key(tree, key);
+                tree_lock.unlock();
+            }
+            ops += 2;
+        }
+        res_lock.lock();
+        res->writes = ops;
+        res_lock.unlock();
+    });
+
+    std::thread* scanners = new std::thread[readers];
+    for (int r = 0; r < readers; r++) {
+        scanners[r] = std::thread([&]() {
+            int slot = versioned ? snapshot_reader_register(vt) : -1;
+            if (versioned && slot < 0) {
+                printf("no free snapshot reader slot\n");
+                return;
+            }
+            long long scans = 0, bad = 0;
+            double total = 0, worst = 0;
+            while (!stop.load()) {
+                ScanCheck check = { 0, 0, 0 };
+                double t0 = now_ms();
+                if (versioned) {
+                    TreeVersion* v = snapshot_pin(vt, slot);
+                    snapshot_scan(v, -1, 2 * n, scan_check_visit, &check);
+                    snapshot_unpin(vt, slot);
+                }
+                else {
+                    tree_lock.lock_shared();
+                    scan_nodes(tree->root, -1, 2 * n, scan_check_visit, &check);
+                    tree_lock.unlock_shared();
+                }
+                double ms = now_ms() - t0;
+                total += ms;
+                if (ms > worst) worst = ms;
+                if (check.unordered || (check.count != n && check.count != n + 1)) bad++;
+                scans++;
+            }
+            if (versioned) snapshot_reader_unregister(vt, slot);
+            res_lock.lock();
+            res->scans += scans;
+            res->bad_scans += bad;
+            res->scan_ms_total += total;
+            if (worst > res->scan_ms_max) res->scan_ms_max = worst;
+            res_lock.unlock();
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds((long long)duration_ms));
+    stop.store(1);
+    writer.join();
+    for (int r = 0; r < readers; r++) scanners[r].join();
+    delete[] scanners;
+
+    if (versioned) free_versioned_tree(vt);
+    else free_tree(tree);
+    free(keys);
+}
+
+int bench_mvcc(void) {
+    const int n = 1000000, readers = 2;
+    const double duration_ms = 3000;
+    const char* names[] = { "writers blocked by scans", "copy-on-write snapshots" };
+    printf("%d keys, 1 writer (insert+delete), %d full-scan readers, %.0f ms\n", n, readers, duration_ms);
+    for (int versioned = 0; versioned <= 1; versioned++) {
+        MvccBenchResult res;
+        bench_mvcc_run(versioned, n, readers, duration_ms, &res);
+        printf("  %-26s: writer %9.0f ops/s, scans %4lld, scan avg %7.1f ms, max %7.1f ms, inconsistent %lld\n",
+            names[versioned], res.writes * 1000.0 / duration_ms, res.scans,
+            res.scans ? res.scan_ms_total / res.scans : 0.0, res.scan_ms_max, res.bad_scans);
+    }
+    return 0;
+}
+
+extern "C" int skipListBenchParallel(void);
+
+int bench_parallel(void) {
+    const int n = 4000000, queries = 200;
+    const int threads[] = { 1, 2, 4, 8, 16, 32 };
+    int* keys = (int*)malloc(sizeof(int) * n);
+    int* lows = (int*)malloc(sizeof(int) * queries);
+    if (!keys || !lows) {
+        free(keys);
+        free(lows);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) keys[i] = (int)(bench_rand() & 0x7fffffff);
+    for (int q = 0; q < queries; q++) lows[q] = (int)(bench_rand() & 0x3fffffff);
+
+    const int serial_n = n / 4;     //  insert ֻ̫ķ֮һ
+    double t0 = now_ms();
+    BPlusTree* tree = create_tree();
+    for (int i = 0; i < serial_n; i++) insert(tree, keys[i]);
+    printf("B+ tree, %d random keys: serial insert of %d keys %.1f ms\n", n, serial_n, now_ms() - t0);
+    free_tree(tree);
+
+    for (int t = 0; t < (int)(sizeof(threads) / sizeof(threads[0])); t++) {
+        ThreadPool* pool = thread_pool_create(threads[t]);
+        int* sorted = (int*)malloc(sizeof(int) * n);
+        memcpy(sorted, keys, sizeof(int) * n);
+        t0 = now_ms();
+        parallel_radix_sort(pool, sorted, n);
+        double sort_ms = now_ms() - t0;
+        t0 = now_ms();
+        tree = parallel_bulk_load(pool, sorted, n);
+        double load_ms = now_ms() - t0;
+        free(sorted);
+
+        RangeAggregate total;
+        aggregate_init(&total);
+        t0 = now_ms();
+        for (int q = 0; q < queries; q++) {
+            RangeAggregate agg;
+            parallel_range_aggregate(pool, tree, lows[q], lows[q] + 0x3fffffff, &agg);
+            aggregate_merge(&total, &agg);
+        }
+        double agg_ms = now_ms() - t0;
+
+        printf("  %2d threads: radix sort %7.1f ms, bulk load %7.1f ms, range aggregate %7.2f ms/query (count %lld)\n",
+            threads[t], sort_ms, load_ms, agg_ms / queries, total.count);
+        free_tree(tree);
+        thread_pool_destroy(pool);
+    }
+    free(keys);
+    free(lows);
+    return skipListBenchParallel();
+}
+
+// 㼶ַtenant/region/service/date/objectͬһ tenant кܳĹǰ׺
+static char* gen_path_keys(int n, char*** out) {
+    static const char* regions[] = { "us-east-1", "us-west-2", "eu-central-1", "ap-southeast-1" };
+    static const char* services[] = { "orders", "payments", "inventory", "shipping", "analytics" };
+    char* buf = (char*)malloc((size_t)n * 96);
+    char** keys = (char**)malloc(sizeof(char*) * n);
+    if (!buf || !keys) {
+        free(buf);
+        free(keys);
+        return NULL;
+    }
+    char* w = buf;
+    for (int i = 0; i < n; i++) {
+        unsigned int r = bench_rand();
+        keys[i] = w;
+        w += sprintf(w, "tenant-%04u/%s/%s/2024/%02u/%02u/object-%09d",
+            r % 500, regions[(r >> 9) % 4], services[(r >> 11) % 5],
+            1 + (r >> 14) % 12, 1 + (r >> 18) % 28, i) + 1;
+    }
+    *out = keys;
+    return buf;
+}
+
+int bench_strkeys(void) {
+    const int n = 1000000, lookups = 1000000;
+    char** keys;
+    char* buf = gen_path_keys(n, &keys);
+    if (!buf) return 1;
+    int* order = (int*)malloc(sizeof(int) * lookups);
+    for (int i = 0; i < lookups; i++) order[i] = (int)(bench_rand() % n);
+    long long raw_bytes = 0;
+    for (int i = 0; i < n; i++) raw_bytes += strlen(keys[i]);
+
+    printf("%d hierarchical string keys, avg %.1f bytes, %d B pages\n", n, (double)raw_bytes / n, STR_NODE_BYTES);
+    const char* names[] = { "plain slotted nodes", "prefix + suffix truncation" };
+    for (int compress = 0; compress <= 1; compress++) {
+        StrBPlusTree* tree = str_create_tree(compress);
+        double t0 = now_ms();
+        for (int i = 0; i < n; i++) str_insert(tree, keys[i]);
+        double insert_ms = now_ms() - t0;
+
+        t0 = now_ms();
+        int hits = 0;
+        for (int i = 0; i < lookups; i++)
+            hits += str_find_key(tree, keys[order[i]]) != NULL;
+        double lookup_ms = now_ms() - t0;
+
+        StrTreeStats st;
+        str_tree_stats(tree, &st);
+        printf("  %-27s: %7lld nodes, %7.1f MB, height %d, %5.1f keys/leaf, separator %5.1f B, "
+            "insert %6.0f ms, lookup %6.1f ns (hits %d)\n",
+            names[compress], st.nodes, st.nodes * (double)STR_NODE_BYTES / (1 << 20), st.height,
+            (double)st.keys / st.leaves, st.separators ? (double)st.separator_bytes / st.separators : 0.0,
+            insert_ms, lookup_ms * 1e6 / lookups, hits);
+        str_free_tree(tree);
+    }
+    free(order);
+    free(keys);
+    free(buf);
+    return 0;
+}
+
+extern "C" int skipListBenchHugepage(void);
+
+static void print_dtlb(long long misses, int lookups) {
+    if (misses < 0) printf("dTLB-load-misses n/a");
+    else printf("dTLB-load-misses %.2f/lookup", (double)misses / lookups);
+}
+
+// ģ飺ֱ malloc  2MB ҳ˹ͬһ
+int bench_hugepage(void) {
+    const int n = 50000000, lookups = 5000000;
+    int* keys = (int*)malloc(sizeof(int) * n);
+    int* queries = (int*)malloc(sizeof(int) * lookups);
+    if (!keys || !queries) {
+        free(keys);
+        free(queries);
+        return 1;
+    }
+    for (int i = 0; i < n; i++) keys[i] = i * 40 + (int)(bench_rand() % 40);
+    for (int i = 0; i < lookups; i++) queries[i] = keys[bench_rand() % n];
+
+    const NodeAllocBackend* backends[] = { &node_alloc_malloc_backend, &node_alloc_hugepage_backend };
+    printf("B+ tree, %d keys, %d random find_key\n", n, lookups);
+    for (int b = 0; b < 2; b++) {
+        if (node_alloc_set_backend(backends[b]) != 0) {
+            printf("  %s: nodes from the previous backend are still live\n", backends[b]->name);
+            free(keys);
+            free(queries);
+            return 1;
+        }
+        node_alloc_set_flags(NODE_ALLOC_EXPLICIT_HUGEPAGES | NODE_ALLOC_NUMA_LOCAL);
+        node_alloc_bind_thread(-1);
+
+        double t0 = now_ms();
+        BPlusTree* tree = bulk_load(keys, n);
+        double load_ms = now_ms() - t0;
+
+        int counter = dtlb_counter_start();
+        t0 = now_ms();
+        int hits = 0;
+        for (int i = 0; i < lookups; i++)
+            hits += find_key(tree, queries[i]) != NULL;
+        double lookup_ms = now_ms() - t0;
+        long long misses = dtlb_counter_stop(counter);
+
+        int regions, explicit_regions;
+        node_alloc_region_stats(&regions, &explicit_regions);
+        printf("  %-8s: build %7.0f ms, lookup %7.1f ns, ", backends[b]->name, load_ms, lookup_ms * 1e6 / lookups);
+        print_dtlb(misses, lookups);
+        printf(", hits %d, 2MB regions %d (explicit %d)\n", hits, regions, explicit_regions);
+
+        free_tree(tree);
+        node_alloc_release_all();
+    }
+    node_alloc_set_backend(NULL);
+    free(keys);
+    free(queries);
+    return skipListBenchHugepage();
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "bench-learned") == 0) return bench_learned();
+    if (argc > 1 && strcmp(argv[1], "bench-mvcc") == 0) return bench_mvcc();
+    if (argc > 1 && strcmp(argv[1], "bench-parallel") == 0) return bench_parallel();
+    if (argc > 1 && strcmp(argv[1], "bench-strkeys") == 0) return bench_strkeys();
+    if (argc > 1 && strcmp(argv[1], "bench-hugepage") == 0) return bench_hugepage();
+
     BPlusTree* tree = create_tree();
     int vals[] = { 1,3,5,7,10,12,15,18,20,22,25,28,30,33,35,40,45,50 };
     for (int i = 0; i < (int)(sizeof(vals) / sizeof(vals[0])); i++) {
@@ -11,6 +11,9 @@
 #include <time.h>
 #include <stdint.h>
 
+#include "ds_alloc.h"
+#include "ds_threadpool.h"
+
  /* ==================== Linux Kernel List API ==================== */
 struct ListHead {
     struct ListHead* next, * prev;
@@ -75,7 +78,7 @@ static int randomLevel(void)
 
 static SkipNode* createNode(void* key, void* value, int level)
 {
-    SkipNode* node = malloc(sizeof(SkipNode) + level * sizeof(struct ListHead));
+    SkipNode* node = node_alloc(sizeof(SkipNode) + level * sizeof(struct ListHead));
     if (!node) return NULL;
     node->key = key;
     node->value = value;
@@ -110,9 +113,9 @@ void skipListDestroy(SkipList* sl)
         listDel(pos);
         free(node->key);
         free(node->value);
-        free(node);
+        node_free(node);
     }
-    free(sl->header);
+    node_free(sl->header);
     free(sl);
 }
 
@@ -204,7 +207,7 @@ void skipListDelete(SkipList* sl, const void* key)
 
     free(target->key);
     free(target->value);
-    free(target);
+    node_free(target);
 
     while (sl->level > 1 &&
         sl->header->forward[sl->level - 1].next == &sl->header->forward[sl->level - 1]) {
@@ -292,7 +295,7 @@ void skipListDeleteAll(SkipList* sl, const void* key)
 
         free(target->key);
         free(target->value);
-        free(target);
+        node_free(target);
     }
 
     /* 3. ղ */
@@ -318,6 +321,278 @@ void skipListPrint(SkipList* sl, void (*printKey)(const void*))
     printf("Max level: %d\n\n", sl->level);
 }
 
+/* ==================== й /  ==================== */
+
+typedef struct SkipEntry {
+    void* key;
+    void* value;
+} SkipEntry;
+
+/*  randomLevel ֲͬʹõԼӣڶ߳ͬʱ */
+static int randomLevelR(unsigned int* seed)
+{
+    int lvl = 1;
+    unsigned int r;
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    r = *seed;
+    while ((r & 1) && lvl < MAX_LEVEL) {
+        lvl++;
+        r >>= 1;
+    }
+    return lvl;
+}
+
+/* ȶ鲢֤ظ key ˳ */
+static void mergeEntries(const SkipEntry* a, int na, const SkipEntry* b, int nb, SkipEntry* out, CompareFn cmp)
+{
+    int i = 0, j = 0, k = 0;
+    while (i < na && j < nb) {
+        if (cmp(b[j].key, a[i].key) < 0) out[k++] = b[j++];
+        else out[k++] = a[i++];
+    }
+    while (i < na) out[k++] = a[i++];
+    while (j < nb) out[k++] = b[j++];
+}
+
+static void mergeSortEntries(SkipEntry* a, SkipEntry* tmp, int n, CompareFn cmp)
+{
+    if (n <= 1) return;
+    int half = n / 2;
+    mergeSortEntries(a, tmp, half, cmp);
+    mergeSortEntries(a + half, tmp + half, n - half, cmp);
+    mergeEntries(a, half, a + half, n - half, tmp, cmp);
+    memcpy(a, tmp, sizeof(SkipEntry) * n);
+}
+
+typedef struct SkipSegment {
+    struct ListHead* first[MAX_LEVEL];
+    struct ListHead* last[MAX_LEVEL];
+    int level;
+} SkipSegment;
+
+typedef struct SkipBuildJob {
+    SkipEntry* entries;
+    SkipEntry* tmp;
+    int n;
+    int chunk;          /* ÿԪ */
+    int width;          /* 鲢Ķγ */
+    CompareFn compare;
+    SkipSegment* segs;
+} SkipBuildJob;
+
+static void sortChunkTask(void* arg, int t)
+{
+    SkipBuildJob* job = arg;
+    int from = t * job->chunk;
+    int to = from + job->chunk < job->n ? from + job->chunk : job->n;
+    mergeSortEntries(job->entries + from, job->tmp + from, to - from, job->compare);
+}
+
+static void mergeRoundTask(void* arg, int t)
+{
+    SkipBuildJob* job = arg;
+    int from = t * 2 * job->width;
+    int mid = from + job->width < job->n ? from + job->width : job->n;
+    int to = mid + job->width < job->n ? mid + job->width : job->n;
+    mergeEntries(job->entries + from, mid - from, job->entries + mid, to - mid, job->tmp + from, job->compare);
+    memcpy(job->entries + from, job->tmp + from, sizeof(SkipEntry) * (to - from));
+}
+
+/* Ϊ t νڵ㲢ڶڰ㴮ãβƴӲ */
+static void buildSegmentTask(void* arg, int t)
+{
+    SkipBuildJob* job = arg;
+    SkipSegment* seg = &job->segs[t];
+    int from = t * job->chunk;
+    int to = from + job->chunk < job->n ? from + job->chunk : job->n;
+    unsigned int seed = 2463534242u + (unsigned int)t * 2654435761u;
+
+    memset(seg, 0, sizeof(*seg));
+    for (int i = from; i < to; i++) {
+        int lvl = randomLevelR(&seed);
+        SkipNode* node = createNode(job->entries[i].key, job->entries[i].value, lvl);
+        if (!node) { free(job->entries[i].key); free(job->entries[i].value); continue; }
+        for (int l = 0; l < lvl; l++) {
+            struct ListHead* link = &node->forward[l];
+            if (seg->last[l]) {
+                seg->last[l]->next = link;
+                link->prev = seg->last[l];
+            }
+            else {
+                seg->first[l] = link;
+            }
+            seg->last[l] = link;
+        }
+        if (lvl > seg->level) seg->level = lvl;
+    }
+}
+
+/*
+ * йȶй鲢  ζڵ  ƴӡ
+ * entries key/value ȨתƸentries ݻᱻ
+ */
+SkipList* skipListBuildParallel(ThreadPool* pool, CompareFn cmp, SkipEntry* entries, int n)
+{
+    SkipList* sl = skipListCreate(cmp);
+    if (!sl || n <= 0) return sl;
+
+    SkipBuildJob job;
+    int tasks = thread_pool_size(pool) * 4;
+    job.entries = entries;
+    job.n = n;
+    job.chunk = (n + tasks - 1) / tasks;
+    job.compare = cmp;
+    tasks = (n + job.chunk - 1) / job.chunk;
+    job.tmp = malloc(sizeof(SkipEntry) * n);
+    job.segs = malloc(sizeof(SkipSegment) * tasks);
+    if (!job.tmp || !job.segs) {
+        free(job.tmp);
+        free(job.segs);
+        for (int i = 0; i < n; i++) skipListInsert(sl, entries[i].key, entries[i].value);
+        return sl;
+    }
+
+    thread_pool_parallel_for(pool, tasks, sortChunkTask, &job);
+    for (job.width = job.chunk; job.width < n; job.width *= 2) {
+        int pairs = (n + 2 * job.width - 1) / (2 * job.width);
+        thread_pool_parallel_for(pool, pairs, mergeRoundTask, &job);
+    }
+
+    thread_pool_parallel_for(pool, tasks, buildSegmentTask, &job);
+
+    for (int l = 0; l < MAX_LEVEL; l++) {
+        struct ListHead* head = &sl->header->forward[l];
+        struct ListHead* tail = head;
+        for (int t = 0; t < tasks; t++) {
+            if (!job.segs[t].first[l]) continue;
+            tail->next = job.segs[t].first[l];
+            job.segs[t].first[l]->prev = tail;
+            tail = job.segs[t].last[l];
+        }
+        tail->next = head;
+        head->prev = tail;
+    }
+    for (int t = 0; t < tasks; t++) {
+        if (job.segs[t].level > sl->level) sl->level = job.segs[t].level;
+    }
+
+    free(job.tmp);
+    free(job.segs);
+    return sl;
+}
+
+/* ͳ [lo, hi] ڵĽڵ */
+int skipListCountRange(SkipList* sl, const void* lo, const void* hi)
+{
+    SkipNode* x = sl->header;
+    for (int i = sl->level - 1; i >= 0; i--) {
+        while (x->forward[i].next != &sl->header->forward[i]) {
+            SkipNode* next = listEntry(x->forward[i].next, SkipNode, forward[i]);
+            if (sl->compare(next->key, lo) >= 0) break;
+            x = next;
+        }
+    }
+    int count = 0;
+    struct ListHead* pos = x->forward[0].next;
+    while (pos != &sl->header->forward[0]) {
+        SkipNode* node = listEntry(pos, SkipNode, forward[0]);
+        if (sl->compare(node->key, hi) > 0) break;
+        count++;
+        pos = pos->next;
+    }
+    return count;
+}
+
+typedef struct SkipCountJob {
+    SkipList* sl;
+    SkipNode** bounds;      /*  t ͳ [bounds[t], bounds[t + 1]) */
+    int num_bounds;
+    const void* hi;
+    int* counts;
+} SkipCountJob;
+
+static void countSegmentTask(void* arg, int t)
+{
+    SkipCountJob* job = arg;
+    SkipList* sl = job->sl;
+    struct ListHead* pos = &job->bounds[t]->forward[0];
+    struct ListHead* stop = t + 1 < job->num_bounds ? &job->bounds[t + 1]->forward[0] : &sl->header->forward[0];
+    int count = 0;
+    while (pos != stop && pos != &sl->header->forward[0]) {
+        SkipNode* node = listEntry(pos, SkipNode, forward[0]);
+        if (sl->compare(node->key, job->hi) > 0) break;
+        count++;
+        pos = pos->next;
+    }
+    job->counts[t] = count;
+}
+
+/*
+ * ø߲гɶΣÿڵײԼ
+ * ߲ҵһ㹻ڵĲ㣬ڵʱ˻Ϊ
+ */
+int skipListCountRangeParallel(ThreadPool* pool, SkipList* sl, const void* lo, const void* hi)
+{
+    SkipNode* update[MAX_LEVEL];
+    SkipNode* x = sl->header;
+    for (int i = sl->level - 1; i >= 0; i--) {
+        while (x->forward[i].next != &sl->header->forward[i]) {
+            SkipNode* next = listEntry(x->forward[i].next, SkipNode, forward[i]);
+            if (sl->compare(next->key, lo) >= 0) break;
+            x = next;
+        }
+        update[i] = x;
+    }
+    if (x->forward[0].next == &sl->header->forward[0]) return 0;
+
+    int want = thread_pool_size(pool) * 4;
+    SkipNode** bounds = malloc(sizeof(SkipNode*) * (want + 1));
+    int* counts = malloc(sizeof(int) * (want + 1));
+    if (!bounds || !counts || want <= 4) {
+        free(bounds);
+        free(counts);
+        return skipListCountRange(sl, lo, hi);
+    }
+
+    /* һδӵһ >= lo Ľڵ㿪ʼ߽ȡԵ l  */
+    int num = 0;
+    bounds[num++] = listEntry(x->forward[0].next, SkipNode, forward[0]);
+    for (int l = sl->level - 1; l > 0; l--) {
+        int inRange = 0;
+        struct ListHead* pos = update[l]->forward[l].next;
+        while (pos != &sl->header->forward[l]) {
+            SkipNode* node = listEntry(pos, SkipNode, forward[l]);
+            if (sl->compare(node->key, hi) > 0) break;
+            inRange++;
+            pos = pos->next;
+        }
+        if (inRange < want && l > 1) continue;
+
+        /* ÿ step ȡһ߽磬 want */
+        int step = inRange / want + 1;
+        int seen = 0;
+        pos = update[l]->forward[l].next;
+        while (pos != &sl->header->forward[l] && num <= want) {
+            SkipNode* node = listEntry(pos, SkipNode, forward[l]);
+            if (sl->compare(node->key, hi) > 0) break;
+            if (seen++ % step == 0 && node != bounds[0]) bounds[num++] = node;
+            pos = pos->next;
+        }
+        break;
+    }
+
+    SkipCountJob job = { sl, bounds, num, hi, counts };
+    thread_pool_parallel_for(pool, num, countSegmentTask, &job);
+    int total = 0;
+    for (int t = 0; t < num; t++) total += counts[t];
+
+    free(bounds);
+    free(counts);
+    return total;
+}
+
 /* ==================== Test: Integer with Duplicates ==================== */
 static int intCmp(const void* a, const void* b)
 {
@@ -329,6 +604,131 @@ static void printInt(const void* p)
     printf("%d", *(int*)p);
 }
 
+/* ==================== Benchmark: Parallel Build ==================== */
+static double nowMs(void)
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static SkipEntry* makeIntEntries(const int* keys, int n)
+{
+    SkipEntry* entries = malloc(sizeof(SkipEntry) * n);
+    if (!entries) return NULL;
+    for (int i = 0; i < n; i++) {
+        int* k = malloc(sizeof(int)), * v = malloc(sizeof(int));
+        *k = keys[i]; *v = i;
+        entries[i].key = k;
+        entries[i].value = v;
+    }
+    return entries;
+}
+
+int skipListBenchParallel(void)
+{
+    const int n = 1000000, queries = 200;
+    const int threads[] = { 1, 2, 4, 8, 16, 32 };
+    int* keys = malloc(sizeof(int) * n);
+    if (!keys) return 1;
+    unsigned int seed = 88172645u;
+    for (int i = 0; i < n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        keys[i] = (int)(seed % 100000000u);
+    }
+
+    SkipEntry* entries = makeIntEntries(keys, n);
+    double t0 = nowMs();
+    SkipList* sl = skipListCreate(intCmp);
+    for (int i = 0; i < n; i++) skipListInsert(sl, entries[i].key, entries[i].value);
+    double insertMs = nowMs() - t0;
+    skipListDestroy(sl);
+    free(entries);
+    printf("skip list, %d random keys: serial skipListInsert %.1f ms\n", n, insertMs);
+
+    for (int t = 0; t < (int)(sizeof(threads) / sizeof(threads[0])); t++) {
+        ThreadPool* pool = thread_pool_create(threads[t]);
+        entries = makeIntEntries(keys, n);
+        t0 = nowMs();
+        sl = skipListBuildParallel(pool, intCmp, entries, n);
+        double buildMs = nowMs() - t0;
+
+        long long total = 0;
+        t0 = nowMs();
+        for (int q = 0; q < queries; q++) {
+            int lo = keys[q] / 2, hi = lo + 50000000;
+            total += skipListCountRangeParallel(pool, sl, &lo, &hi);
+        }
+        double countMs = nowMs() - t0;
+
+        printf("  %2d threads: build %8.1f ms, count_range %7.2f ms/query (total %lld)\n",
+            threads[t], buildMs, countMs / queries, total);
+        skipListDestroy(sl);
+        free(entries);
+        thread_pool_destroy(pool);
+    }
+    free(keys);
+    return 0;
+}
+
+/* ==================== Benchmark: Hugepage Node Backend ==================== */
+int skipListBenchHugepage(void)
+{
+    const int n = 5000000, lookups = 2000000;
+    const NodeAllocBackend* backends[] = { &node_alloc_malloc_backend, &node_alloc_hugepage_backend };
+    int* keys = malloc(sizeof(int) * n);
+    int* queries = malloc(sizeof(int) * lookups);
+    if (!keys || !queries) { free(keys); free(queries); return 1; }
+    unsigned int seed = 88172645u;
+    for (int i = 0; i < n; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        keys[i] = (int)(seed & 0x3fffffff);    /* intCmp üȽϣܳ 2^30 */
+    }
+    for (int i = 0; i < lookups; i++) {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+        queries[i] = keys[seed % n];
+    }
+
+    printf("skip list, %d keys, %d random point lookups\n", n, lookups);
+    for (int b = 0; b < 2; b++) {
+        if (node_alloc_set_backend(backends[b]) != 0) {
+            printf("  %s: nodes from the previous backend are still live\n", backends[b]->name);
+            free(keys);
+            free(queries);
+            return 1;
+        }
+        node_alloc_set_flags(NODE_ALLOC_EXPLICIT_HUGEPAGES | NODE_ALLOC_NUMA_LOCAL);
+        node_alloc_bind_thread(-1);
+
+        SkipEntry* entries = makeIntEntries(keys, n);
+        double t0 = nowMs();
+        SkipList* sl = skipListBuildParallel(NULL, intCmp, entries, n);
+        double buildMs = nowMs() - t0;
+        free(entries);
+
+        int counter = dtlb_counter_start();
+        int hits = 0;
+        t0 = nowMs();
+        /* õң skipListSearch ͬ½ȷж */
+        for (int i = 0; i < lookups; i++)
+            hits += skipListCountRange(sl, &queries[i], &queries[i]) > 0;
+        double lookupMs = nowMs() - t0;
+        long long misses = dtlb_counter_stop(counter);
+
+        printf("  %-8s: build %7.0f ms, lookup %7.1f ns, ", backends[b]->name, buildMs, lookupMs * 1e6 / lookups);
+        if (misses < 0) printf("dTLB-load-misses n/a");
+        else printf("dTLB-load-misses %.2f/lookup", (double)misses / lookups);
+        printf(", hits %d\n", hits);
+
+        skipListDestroy(sl);
+        node_alloc_release_all();
+    }
+    node_alloc_set_backend(NULL);
+    free(keys);
+    free(queries);
+    return 0;
+}
+
 int main2(void)
 {
     srand(time(NULL));
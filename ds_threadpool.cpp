@@ -0,0 +1,130 @@
+#include "ds_threadpool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+typedef struct PoolTask {
+    ParallelFn fn;
+    void* arg;
+    int index;
+    std::atomic<int>* pending;      //  parallel_for δɵ
+} PoolTask;
+
+typedef struct WorkQueue {
+    std::mutex lock;
+    std::deque<PoolTask> tasks;
+} WorkQueue;
+
+// queues[0 .. num_threads-2] ڹ̣߳queues[num_threads-1] ĵ߳
+struct ThreadPool {
+    int num_threads;
+    WorkQueue* queues;
+    std::thread* workers;
+    std::atomic<int> queued;
+    std::atomic<int> stop;
+    std::mutex idle_lock;
+    std::condition_variable idle_cv;
+};
+
+static thread_local ThreadPool* current_pool = NULL;
+static thread_local int current_worker = -1;
+
+static int self_queue(ThreadPool* pool) {
+    return current_pool == pool ? current_worker : pool->num_threads - 1;
+}
+
+// ȡԼβ롢ȣδͷȡ
+static int run_one(ThreadPool* pool, int self) {
+    PoolTask task;
+    int found = 0;
+    for (int i = 0; i < pool->num_threads && !found; i++) {
+        WorkQueue* q = &pool->queues[(self + i) % pool->num_threads];
+        q->lock.lock();
+        if (!q->tasks.empty()) {
+            if (i == 0) {
+                task = q->tasks.back();
+                q->tasks.pop_back();
+            }
+            else {
+                task = q->tasks.front();
+                q->tasks.pop_front();
+            }
+            found = 1;
+        }
+        q->lock.unlock();
+    }
+    if (!found) return 0;
+    pool->queued.fetch_sub(1);
+    task.fn(task.arg, task.index);
+    task.pending->fetch_sub(1);
+    return 1;
+}
+
+static void worker_main(ThreadPool* pool, int self) {
+    current_pool = pool;
+    current_worker = self;
+    while (!pool->stop.load()) {
+        if (run_one(pool, self)) continue;
+        std::unique_lock<std::mutex> guard(pool->idle_lock);
+        pool->idle_cv.wait(guard, [pool]() { return pool->stop.load() || pool->queued.load() > 0; });
+    }
+}
+
+ThreadPool* thread_pool_create(int num_threads) {
+    if (num_threads < 1) num_threads = 1;
+    ThreadPool* pool = new ThreadPool();
+    pool->num_threads = num_threads;
+    pool->queues = new WorkQueue[num_threads];
+    pool->queued.store(0);
+    pool->stop.store(0);
+    pool->workers = new std::thread[num_threads - 1];
+    for (int i = 0; i < num_threads - 1; i++)
+        pool->workers[i] = std::thread(worker_main, pool, i);
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) return;
+    pool->idle_lock.lock();
+    pool->stop.store(1);
+    pool->idle_lock.unlock();
+    pool->idle_cv.notify_all();
+    for (int i = 0; i < pool->num_threads - 1; i++)
+        pool->workers[i].join();
+    delete[] pool->workers;
+    delete[] pool->queues;
+    delete pool;
+}
+
+int thread_pool_size(ThreadPool* pool) {
+    return pool ? pool->num_threads : 1;
+}
+
+void thread_pool_parallel_for(ThreadPool* pool, int n, ParallelFn fn, void* arg) {
+    if (!pool || pool->num_threads <= 1 || n <= 1) {
+        for (int i = 0; i < n; i++) fn(arg, i);
+        return;
+    }
+
+    std::atomic<int> pending(n);
+    int self = self_queue(pool);
+    // ʱɢУ߳Ƕ׵ʱѹԼУ߳ȡ
+    for (int i = 0; i < n; i++) {
+        int q = current_pool == pool ? self : i % pool->num_threads;
+        PoolTask task = { fn, arg, i, &pending };
+        pool->queues[q].lock.lock();
+        pool->queues[q].tasks.push_back(task);
+        pool->queues[q].lock.unlock();
+    }
+    pool->idle_lock.lock();
+    pool->queued.fetch_add(n);
+    pool->idle_lock.unlock();
+    pool->idle_cv.notify_all();
+
+    while (pending.load() > 0) {
+        if (!run_one(pool, self)) std::this_thread::yield();
+    }
+}
@@ -0,0 +1,30 @@
+/*********************************************************************
+ * Work-stealing thread pool
+ * - ÿ߳һ˫˶УԼβȡʱӱͷȡ
+ * -  threadPool ߳ڵȴڼҲִԿǶ׵
+ * - C ӿڣB+ 
+ *********************************************************************/
+#ifndef DS_THREADPOOL_H
+#define DS_THREADPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ThreadPool ThreadPool;
+
+typedef void (*ParallelFn)(void* arg, int index);
+
+/* num_threads ̱߳num_threads <= 1 ʱڵִ߳ */
+ThreadPool* thread_pool_create(int num_threads);
+void thread_pool_destroy(ThreadPool* pool);
+int thread_pool_size(ThreadPool* pool);
+
+/*  [0, n) ÿ index ִ fn(arg, index)ȫɺ󷵻ءpool Ϊ NULL ʱִ */
+void thread_pool_parallel_for(ThreadPool* pool, int n, ParallelFn fn, void* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif